@@ -0,0 +1,266 @@
+/**
+ * @file effects.cpp
+ *
+ * @brief Implementation of the built-in post-mix effects of the Laser VST
+ * Plugin.
+ *
+ * This file implements the StereoDelay and Chorus effects declared in
+ * effects.h.
+ *
+ * @details
+ * The inner loops work on contiguous runs of memory with `__restrict`
+ * pointers: for the delay a run never exceeds the delay time, so the
+ * samples read and the samples written never overlap, and for the chorus
+ * the modulated taps are gathered into a small scratch block before the
+ * input is written. This keeps every loop free of loop-carried dependencies
+ * so it vectorizes.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - Standard Math Library (math.h)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "effects.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Radar {
+
+// Tempo sync divisions in quarter notes:
+// 1/16, 1/8T, 1/8, 1/4T, 1/8., 1/4, 1/4., 1/2, 1/1
+static const float kSyncDivisions[StereoDelay::kNumSyncDivisions] = {
+    0.25f, 1.f / 3.f, 0.5f, 2.f / 3.f, 0.75f, 1.f, 1.5f, 2.f, 4.f};
+
+static const float kTwoPi = 6.28318530718f;
+
+//-----------------------------------------------------------------------------
+// StereoDelay
+//-----------------------------------------------------------------------------
+void StereoDelay::carve(Arena& arena, SampleRate newSampleRate) {
+  sampleRate = newSampleRate;
+  int32 maxDelay = (int32) (kMaxTimeMs * 0.001 * sampleRate) + 1;
+  lineL.carve(arena, maxDelay + 1);
+  lineR.carve(arena, maxDelay + 1);
+  glideCoefficient = 1.f - expf(-(float) kGlideChunk /
+                                (kGlideTime * (float) sampleRate));
+
+  // Starts over as if turned on, on the next setParameters()
+  mix = 0.f;
+  history = 0;
+}
+
+//-----------------------------------------------------------------------------
+float StereoDelay::timeToMs(float time) {
+  return kMinTimeMs * powf(kMaxTimeMs / kMinTimeMs, time);
+}
+
+//-----------------------------------------------------------------------------
+float StereoDelay::timeToQuarters(float time) {
+  int32 index = std::min((int32) (time * kNumSyncDivisions),
+                         kNumSyncDivisions - 1);
+  return kSyncDivisions[std::max(index, 0)];
+}
+
+//-----------------------------------------------------------------------------
+void StereoDelay::setParameters(float newMix, float time, float newFeedback,
+                                bool sync, double tempo) {
+  const bool turnedOn = isBypassed() && newMix > 0.f;
+  mix = newMix;
+  feedback = newFeedback * kMaxFeedback;
+
+  float ms = (sync && tempo > 0.)
+                 ? timeToQuarters(time) * 60000.f / (float) tempo
+                 : timeToMs(time);
+  ms = std::min(ms, kMaxTimeMs);
+
+  int32 samples = (int32) (ms * 0.001f * (float) sampleRate + 0.5f);
+  delaySamples = (double) std::max(1, std::min(samples, lineL.size() - 1));
+
+  // Coming back from bypass: whatever is left in the lines is stale, and
+  // there is nothing to glide from
+  if (turnedOn) {
+    history = 0;
+    tapDelay = delaySamples;
+  }
+}
+
+//-----------------------------------------------------------------------------
+static void delayRun(const Sample32* __restrict read,
+                     Sample32* __restrict write, Sample32* __restrict io,
+                     int32 numSamples, float mix, float feedback) {
+  for (int32 i = 0; i < numSamples; i++) {
+    float delayed = read[i];
+    float input = io[i];
+    write[i] = input + delayed * feedback;
+    io[i] = input + delayed * mix;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void StereoDelay::glideRun(RingBuffer& line, Sample32* samples,
+                           int32 numSamples, float step) const {
+  // Sample by sample: a tap gliding shorter can come closer than a chunk.
+  // Interpolation reads one sample further back, only written ones count.
+  const int32 writeIndex = line.getWriteIndex();
+  Sample32* __restrict io = samples;
+  for (int32 i = 0; i < numSamples; i++) {
+    float delay = (float) tapDelay + step * (float) i;
+    float delayed = (delay + 1.f <= (float) (history + i))
+                        ? line.readFractional(i, delay)
+                        : 0.f;
+    float input = io[i];
+    *line.at(line.wrap(writeIndex + i)) = input + delayed * feedback;
+    io[i] = input + delayed * mix;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void StereoDelay::glide(Sample32* left, Sample32* right, int32 numSamples) {
+  double nextDelay = tapDelay + (delaySamples - tapDelay) * glideCoefficient;
+  if (fabs(delaySamples - nextDelay) < kSnapDistance) {
+    nextDelay = delaySamples;
+  }
+
+  float step = (float) (nextDelay - tapDelay) / (float) numSamples;
+  glideRun(lineL, left, numSamples, step);
+  glideRun(lineR, right, numSamples, step);
+
+  lineL.advance(numSamples);
+  lineR.advance(numSamples);
+  addHistory(numSamples);
+  tapDelay = nextDelay;
+}
+
+//-----------------------------------------------------------------------------
+void StereoDelay::process(Sample32* left, Sample32* right, int32 numSamples) {
+  // A new delay time is reached chunk by chunk
+  int32 done = 0;
+  while (done < numSamples && tapDelay != delaySamples) {
+    int32 chunk = std::min(kGlideChunk, numSamples - done);
+    glide(left + done, right + done, chunk);
+    done += chunk;
+  }
+
+  // Both lines share the same positions, split the rest of the block into
+  // runs that do not wrap and do not read what they write
+  const int32 delay = (int32) tapDelay;
+  while (done < numSamples) {
+    int32 writeIndex = lineL.getWriteIndex();
+    int32 readIndex = lineL.wrap(writeIndex - delay);
+    int32 run = std::min({numSamples - done, delay,
+                          lineL.contiguous(writeIndex),
+                          lineL.contiguous(readIndex)});
+
+    // Samples from before the delay was turned on are stale: until the
+    // tap reaches the first one written since, it reads silence
+    if (history < delay) {
+      run = std::min(run, delay - history);
+      memcpy(lineL.at(writeIndex), left + done, sizeof(Sample32) * run);
+      memcpy(lineR.at(writeIndex), right + done, sizeof(Sample32) * run);
+    } else {
+      delayRun(lineL.at(readIndex), lineL.at(writeIndex), left + done, run,
+               mix, feedback);
+      delayRun(lineR.at(readIndex), lineR.at(writeIndex), right + done, run,
+               mix, feedback);
+    }
+
+    lineL.advance(run);
+    lineR.advance(run);
+    addHistory(run);
+    done += run;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Chorus
+//-----------------------------------------------------------------------------
+void Chorus::carve(Arena& arena, SampleRate newSampleRate) {
+  sampleRate = newSampleRate;
+  baseSamples = kBaseDelayMs * 0.001f * (float) sampleRate;
+  int32 maxDelay =
+      (int32) ((kBaseDelayMs + kMaxDepthMs) * 0.001 * sampleRate) + 2;
+  lineL.carve(arena, maxDelay + kChunkSize);
+  lineR.carve(arena, maxDelay + kChunkSize);
+}
+
+//-----------------------------------------------------------------------------
+float Chorus::rateToHz(float rate) {
+  return kMinRateHz * powf(kMaxRateHz / kMinRateHz, rate);
+}
+
+//-----------------------------------------------------------------------------
+void Chorus::setParameters(float newMix, float rate, float depth) {
+  if (isBypassed() && newMix > 0.f) {
+    needsClear = true;
+  }
+
+  mix = newMix;
+  phaseIncrement = rateToHz(rate) / (float) sampleRate;
+  depthSamples = depth * kMaxDepthMs * 0.001f * (float) sampleRate;
+}
+
+//-----------------------------------------------------------------------------
+float Chorus::tapDelay(float lfoPhase) const {
+  return baseSamples + depthSamples * sinf(kTwoPi * lfoPhase);
+}
+
+//-----------------------------------------------------------------------------
+void Chorus::processChannel(RingBuffer& line, Sample32* samples,
+                            int32 numSamples, float delayStart,
+                            float delayEnd) {
+  // The shortest tap is longer than a chunk, so every tap reads samples
+  // written by earlier chunks: gather first, then write the input
+  Sample32 wet[kChunkSize];
+  float step = (delayEnd - delayStart) / (float) numSamples;
+  for (int32 i = 0; i < numSamples; i++) {
+    wet[i] = line.readFractional(i, delayStart + step * (float) i);
+  }
+
+  int32 writeIndex = line.getWriteIndex();
+  int32 head = std::min(numSamples, line.contiguous(writeIndex));
+  memcpy(line.at(writeIndex), samples, sizeof(Sample32) * head);
+  memcpy(line.at(0), samples + head, sizeof(Sample32) * (numSamples - head));
+
+  Sample32* __restrict io = samples;
+  for (int32 i = 0; i < numSamples; i++) {
+    io[i] += wet[i] * mix;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void Chorus::process(Sample32* left, Sample32* right, int32 numSamples) {
+  if (needsClear) {
+    lineL.clear();
+    lineR.clear();
+    needsClear = false;
+  }
+
+  // The LFO runs at chunk rate, the tap delay is ramped across each chunk
+  for (int32 done = 0; done < numSamples; done += kChunkSize) {
+    int32 chunk = std::min(kChunkSize, numSamples - done);
+
+    float nextPhase = phase + phaseIncrement * (float) chunk;
+    nextPhase -= floorf(nextPhase);
+
+    // Right channel runs a quarter period ahead for stereo width
+    processChannel(lineL, left + done, chunk, tapDelay(phase),
+                   tapDelay(nextPhase));
+    processChannel(lineR, right + done, chunk, tapDelay(phase + 0.25f),
+                   tapDelay(nextPhase + 0.25f));
+
+    lineL.advance(chunk);
+    lineR.advance(chunk);
+    phase = nextPhase;
+  }
+}
+
+//-----------------------------------------------------------------------------
+}  // namespace Radar
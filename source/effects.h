@@ -0,0 +1,182 @@
+/**
+ * @file effects.h
+ *
+ * @brief Declaration of the built-in post-mix effects of the Laser VST
+ * Plugin.
+ *
+ * This file defines the StereoDelay and Chorus effects, which process the
+ * mix bus of the Laser Processor in place before the output stage.
+ *
+ * @details
+ * Both effects run on RingBuffer delay lines carved from the processor's
+ * Arena, so they never allocate while processing. Blocks are split into
+ * runs that neither wrap around the end of a delay line nor read samples
+ * written in the same run; the loops over those runs have no dependencies
+ * between iterations and are vectorized by the compiler.
+ *
+ * An effect whose mix is 0 is skipped entirely. When it is turned on again
+ * no stale echoes come back: the chorus clears its short lines, the delay
+ * reads silence wherever its line still holds samples from before, so its
+ * up to two seconds of line are never cleared on the audio thread.
+ *
+ * A new delay time does not move the delay tap at once, which would click:
+ * the tap glides there along a one pole curve, re-aimed every kGlideChunk
+ * samples and interpolated in between, like a tape delay changing speed.
+ *
+ * Features:
+ * - Stereo delay with feedback, tempo sync to the host and click free
+ *   delay time changes.
+ * - Stereo chorus with quadrature LFOs and interpolated delay taps.
+ * - Zero-cost bypass at mix 0.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef EFFECTS_H_
+#define EFFECTS_H_
+
+#include <algorithm>
+
+#include "arena.h"
+#include "ring_buffer.h"
+
+#include "pluginterfaces/vst/vsttypes.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/**
+ * @class StereoDelay
+ * @brief Feedback delay with independent left and right lines.
+ */
+class StereoDelay {
+ public:
+  static constexpr float kMinTimeMs = 10.f;        ///< Shortest free time.
+  static constexpr float kMaxTimeMs = 2000.f;      ///< Longest delay time.
+  static constexpr float kMaxFeedback = 0.95f;     ///< Feedback at 1.0.
+  static constexpr int32 kNumSyncDivisions = 9;    ///< Tempo sync steps.
+  static constexpr float kGlideTime = 0.05f;       ///< Glide constant, s.
+  static constexpr int32 kGlideChunk = 32;         ///< Glide update, samples.
+  static constexpr double kSnapDistance = 1e-3;    ///< Ends a glide, samples.
+
+  /// Carves both delay lines for `sampleRate`.
+  void carve(Arena& arena, SampleRate sampleRate);
+
+  /**
+   * @brief Updates the delay from normalized parameter values.
+   *
+   * @param mix       Wet level [0..1], 0 bypasses the delay.
+   * @param time      Delay time, or the note division when synced [0..1].
+   * @param feedback  Feedback amount [0..1].
+   * @param sync      Whether `time` selects a note division.
+   * @param tempo     Host tempo in BPM, used when synced.
+   */
+  void setParameters(float mix, float time, float feedback, bool sync,
+                     double tempo);
+
+  /// Whether process() would do nothing.
+  bool isBypassed() const { return mix <= 0.f; }
+
+  /// Processes the stereo bus in place.
+  void process(Sample32* left, Sample32* right, int32 numSamples);
+
+  /// Converts a normalized time into milliseconds for a free running delay.
+  static float timeToMs(float time);
+
+  /// Converts a normalized time into a note division in quarter notes.
+  static float timeToQuarters(float time);
+
+ private:
+  /// Processes one chunk while the tap glides, at most kGlideChunk samples.
+  void glide(Sample32* left, Sample32* right, int32 numSamples);
+
+  /// Reads and writes one line sample by sample along a gliding tap.
+  void glideRun(RingBuffer& line, Sample32* samples, int32 numSamples,
+                float step) const;
+
+  /// Marks `numSamples` more samples of the lines as written since the
+  /// delay was turned on.
+  void addHistory(int32 numSamples) {
+    history = std::min(history + numSamples, lineL.size());
+  }
+
+  RingBuffer lineL;
+  RingBuffer lineR;
+  SampleRate sampleRate = 44100.;
+  float mix = 0.f;
+  float feedback = 0.f;
+  float glideCoefficient = 1.f;  ///< Glide progress per chunk.
+  double delaySamples = 1.;      ///< Delay time set, whole samples.
+  double tapDelay = 1.;          ///< Delay the tap is at, in samples.
+  int32 history = 0;  ///< Samples written since the delay was turned on.
+};
+
+/**
+ * @class Chorus
+ * @brief Stereo chorus with one modulated delay tap per channel.
+ */
+class Chorus {
+ public:
+  static constexpr float kBaseDelayMs = 12.f;  ///< Center of the sweep.
+  static constexpr float kMaxDepthMs = 8.f;    ///< Sweep at depth 1.0.
+  static constexpr float kMinRateHz = 0.05f;   ///< LFO rate at 0.
+  static constexpr float kMaxRateHz = 5.f;     ///< LFO rate at 1.
+  static constexpr int32 kChunkSize = 32;      ///< LFO update interval.
+
+  /// Carves both delay lines for `sampleRate`.
+  void carve(Arena& arena, SampleRate sampleRate);
+
+  /**
+   * @brief Updates the chorus from normalized parameter values.
+   *
+   * @param mix    Wet level [0..1], 0 bypasses the chorus.
+   * @param rate   LFO rate [0..1].
+   * @param depth  Sweep depth [0..1].
+   */
+  void setParameters(float mix, float rate, float depth);
+
+  /// Whether process() would do nothing.
+  bool isBypassed() const { return mix <= 0.f; }
+
+  /// Processes the stereo bus in place.
+  void process(Sample32* left, Sample32* right, int32 numSamples);
+
+  /// LFO phase [0..1), for the flight recorder.
+  float getPhase() const { return phase; }
+
+  /// Restores a phase returned by getPhase().
+  void setPhase(float newPhase) { phase = newPhase; }
+
+  /// Converts a normalized rate into Hz.
+  static float rateToHz(float rate);
+
+ private:
+  /// Delay of the tap in samples for the LFO at `phase`.
+  float tapDelay(float phase) const;
+
+  void processChannel(RingBuffer& line, Sample32* samples, int32 numSamples,
+                      float delayStart, float delayEnd);
+
+  RingBuffer lineL;
+  RingBuffer lineR;
+  SampleRate sampleRate = 44100.;
+  float mix = 0.f;
+  float depthSamples = 0.f;
+  float baseSamples = 0.f;
+  float phaseIncrement = 0.f;  ///< LFO phase increment per sample [0..1).
+  float phase = 0.f;           ///< LFO phase [0..1).
+  bool needsClear = false;
+};
+
+}  // namespace Radar
+
+#endif  // EFFECTS_H_
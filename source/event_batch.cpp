@@ -0,0 +1,230 @@
+/**
+ * @file event_batch.cpp
+ *
+ * @brief Implementation of the event preprocessing of the Laser VST Plugin.
+ *
+ * This file implements the EventBatch class declared in event_batch.h.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "event_batch.h"
+
+#include <algorithm>
+
+namespace Radar {
+
+//-----------------------------------------------------------------------------
+void EventBatch::carve(Arena& arena, int32 maxSamplesPerBlock) {
+  events = arena.carve<Event>(kMaxEvents);
+  order = arena.carve<int32>(kMaxEvents);
+  offsetCounts = arena.carve<int32>(std::max(1, maxSamplesPerBlock));
+  previousNoteOn = arena.carve<int32>(kMaxEvents);
+  keys = arena.carve<KeyState>(kNumChannels * kNumPitches);
+  expressionSlots = arena.carve<ExpressionSlot>(kNumExpressionSlots);
+  generation = 0;
+  numRead = 0;
+  numKept = 0;
+}
+
+//-----------------------------------------------------------------------------
+int32 EventBatch::read(IEventList& list, int32 first) {
+  numRead = 0;
+  numKept = 0;
+
+  const int32 count = list.getEventCount();
+  if (!events.data) {
+    return count;
+  }
+
+  int32 index = first;
+  for (; index < count && numRead < kMaxEvents; index++) {
+    if (list.getEvent(index, events[numRead]) == kResultOk) {
+      numRead++;
+    }
+  }
+  return index;
+}
+
+//-----------------------------------------------------------------------------
+void EventBatch::prepare(bool newMatchChannel, bool cancelNotes) {
+  numKept = 0;
+  if (numRead == 0) {
+    return;
+  }
+  matchChannel = newMatchChannel;
+  nextGeneration();
+  sortByOffset();
+
+  for (int32 i = 0; i < numRead; i++) {
+    const int32 index = order[i];
+    const Event& event = events[index];
+    switch (event.type) {
+      case Event::kNoteOnEvent:
+        if (KeyState* key = getKey(event.noteOn.channel, event.noteOn.pitch)) {
+          previousNoteOn[index] = key->lastNoteOn;
+          key->lastNoteOn = index;
+        }
+        break;
+
+      case Event::kNoteOffEvent:
+        if (!cancelNotes) {
+          break;
+        }
+        if (KeyState* key =
+                getKey(event.noteOff.channel, event.noteOff.pitch)) {
+          noteOff(index, *key);
+        }
+        break;
+
+      case Event::kNoteExpressionValueEvent:
+        expressionValue(index);
+        break;
+    }
+  }
+
+  // Close the gaps of the removed events, the order stays sorted
+  for (int32 i = 0; i < numRead; i++) {
+    if (events[order[i]].type != kDroppedEvent) {
+      order[numKept++] = order[i];
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EventBatch::nextGeneration() {
+  if (++generation == 0) {
+    // After 2^32 batches stale entries would look current again
+    for (KeyState& key : keys) {
+      key = KeyState();
+    }
+    for (ExpressionSlot& slot : expressionSlots) {
+      slot = ExpressionSlot();
+    }
+    generation = 1;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int32 EventBatch::getOffset(int32 index) const {
+  return std::min(std::max(0, events[index].sampleOffset),
+                  offsetCounts.size - 1);
+}
+
+//-----------------------------------------------------------------------------
+void EventBatch::sortByOffset() {
+  bool sorted = true;
+  for (int32 i = 0; i < numRead; i++) {
+    order[i] = i;
+    if (i > 0 && getOffset(i) < getOffset(i - 1)) {
+      sorted = false;
+    }
+  }
+  if (sorted) {
+    return;
+  }
+
+  // Counting sort: linear, stable, and offsets are bounded by the block
+  offsetCounts.clear();
+  for (int32 i = 0; i < numRead; i++) {
+    offsetCounts[getOffset(i)]++;
+  }
+  int32 start = 0;
+  for (int32& count : offsetCounts) {
+    const int32 next = start + count;
+    count = start;
+    start = next;
+  }
+  for (int32 i = 0; i < numRead; i++) {
+    order[offsetCounts[getOffset(i)]++] = i;
+  }
+}
+
+//-----------------------------------------------------------------------------
+EventBatch::KeyState* EventBatch::getKey(int16 channel, int16 pitch) {
+  if (pitch < 0 || pitch >= kNumPitches) {
+    return nullptr;
+  }
+  int32 index = pitch;
+  if (matchChannel) {
+    if (channel < 0 || channel >= kNumChannels) {
+      return nullptr;
+    }
+    index += channel * kNumPitches;
+  }
+
+  KeyState& key = keys[index];
+  if (key.generation != generation) {
+    key.generation = generation;
+    key.lastNoteOn = -1;
+    key.released = false;
+  }
+  return &key;
+}
+
+//-----------------------------------------------------------------------------
+void EventBatch::noteOff(int32 index, KeyState& key) {
+  Event& event = events[index];
+
+  // With a note ID the NoteOff only ends the note of that ID
+  if (event.noteOff.noteId != -1) {
+    for (int32* link = &key.lastNoteOn; *link >= 0;
+         link = &previousNoteOn[*link]) {
+      Event& noteOn = events[*link];
+      if (noteOn.noteOn.noteId == event.noteOff.noteId) {
+        noteOn.type = kDroppedEvent;
+        event.type = kDroppedEvent;
+        *link = previousNoteOn[*link];
+        return;
+      }
+    }
+    return;
+  }
+
+  // Without one it releases every voice of the key, the ones the pending
+  // NoteOns would start included
+  for (int32 noteOn = key.lastNoteOn; noteOn >= 0;
+       noteOn = previousNoteOn[noteOn]) {
+    events[noteOn].type = kDroppedEvent;
+  }
+  key.lastNoteOn = -1;
+
+  if (key.released) {
+    event.type = kDroppedEvent;
+  }
+  key.released = true;
+}
+
+//-----------------------------------------------------------------------------
+void EventBatch::expressionValue(int32 index) {
+  const NoteExpressionValueEvent& value = events[index].noteExpressionValue;
+  uint32 hash = (uint32) value.noteId * 2654435761u ^
+                (uint32) value.typeId * 40503u;
+
+  // Open addressing, the table is never more than half full
+  for (;; hash++) {
+    ExpressionSlot& slot = expressionSlots[hash & (kNumExpressionSlots - 1)];
+    if (slot.generation != generation) {
+      slot.generation = generation;
+      slot.noteId = value.noteId;
+      slot.typeId = value.typeId;
+      slot.event = index;
+      return;
+    }
+    if (slot.noteId == value.noteId && slot.typeId == value.typeId) {
+      // Targets are only read after the events, the last value wins
+      events[slot.event].type = kDroppedEvent;
+      slot.event = index;
+      return;
+    }
+  }
+}
+
+}  // namespace Radar
@@ -0,0 +1,153 @@
+/**
+ * @file event_batch.h
+ *
+ * @brief Event preprocessing of the Laser VST Plugin.
+ *
+ * This file defines the EventBatch class, which reads the event list of a
+ * block in one go, sorts it by sample offset and drops the events that
+ * cannot change what is heard before the voices are allocated.
+ *
+ * @details
+ * Events take effect at the start of the block they arrive in. A note that
+ * is switched on and off again within one block therefore never sounds, it
+ * would only take a voice away from a note that does. Arpeggiators and other
+ * MIDI generating plug-ins send hundreds of such events per block, so the
+ * batch removes them before the processor sees them:
+ *
+ * - A NoteOn and a later NoteOff of the same note in the batch cancel each
+ *   other. A NoteOff with a note ID only cancels the NoteOn of that ID. A
+ *   NoteOff without one releases every voice of its key, so it cancels all
+ *   pending NoteOns of the key and is itself kept, unless an earlier NoteOff
+ *   of the key in the batch already released those voices.
+ *   While the sustain pedal is down notes do not end on their NoteOff, so
+ *   the processor turns the cancellation off and every note is kept.
+ * - Of several note expression values of the same note and type only the
+ *   last one is kept.
+ *
+ * The key of a note is its pitch, plus its channel in MPE mode, matching
+ * how the processor matches NoteOffs without a note ID. All working memory
+ * is carved from the processor's arena; per key state is invalidated by a
+ * generation counter instead of being cleared every block.
+ *
+ * Features:
+ * - One pass over the host's event list per batch.
+ * - Stable counting sort by sample offset, skipped when already sorted.
+ * - Cancellation of notes that never sound and of redundant events.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef EVENT_BATCH_H_
+#define EVENT_BATCH_H_
+
+#include "arena.h"
+#include "voice.h"
+
+#include "pluginterfaces/vst/ivstevents.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/**
+ * @class EventBatch
+ * @brief The events of one block, sorted and coalesced before dispatch.
+ *
+ * Lists longer than kMaxEvents are handled in consecutive batches, each one
+ * coalesced on its own.
+ */
+class EventBatch {
+ public:
+  static constexpr int32 kMaxEvents = 1024;  ///< Events per batch.
+  static constexpr int32 kNumChannels = 16;  ///< MIDI channels.
+  static constexpr int32 kNumPitches = 128;  ///< MIDI pitches.
+
+  /// Carves the event storage and the lookup tables.
+  void carve(Arena& arena, int32 maxSamplesPerBlock);
+
+  /**
+   * @brief Reads up to kMaxEvents events of `list`, starting at `first`.
+   *
+   * @return The index of the first event not read yet. Without carved
+   * memory nothing is read and the whole list counts as consumed.
+   */
+  int32 read(IEventList& list, int32 first);
+
+  /// Number of events read by the last read().
+  int32 getNumRead() const { return numRead; }
+
+  /// Event `index` of the last read(), in host order.
+  const Event& getRead(int32 index) const { return events[index]; }
+
+  /**
+   * @brief Sorts the events read by sample offset and removes the ones
+   * without effect.
+   *
+   * @param matchChannel Whether notes are keyed by channel and pitch (MPE)
+   * or by pitch only.
+   * @param cancelNotes Whether NoteOns and NoteOffs may cancel each other,
+   * false while a pedal makes every played note sound.
+   */
+  void prepare(bool matchChannel, bool cancelNotes);
+
+  /// Number of events left by prepare().
+  int32 size() const { return numKept; }
+
+  /// Event `index` of the prepared batch, in sample offset order.
+  const Event& operator[](int32 index) const {
+    return events[order[index]];
+  }
+
+  /// Number of events prepare() removed from the batch.
+  int32 getNumDropped() const { return numRead - numKept; }
+
+ private:
+  /// State of one note key within the current batch.
+  struct KeyState {
+    uint32 generation = 0;  ///< Valid only if equal to the batch's.
+    int32 lastNoteOn = -1;  ///< Latest pending NoteOn, -1 if none.
+    bool released = false;  ///< Voices of the key were released already.
+  };
+
+  /// Latest expression value of one note and type within the batch.
+  struct ExpressionSlot {
+    uint32 generation = 0;
+    int32 noteId = 0;
+    NoteExpressionTypeID typeId = 0;
+    int32 event = 0;
+  };
+
+  static constexpr int32 kNumExpressionSlots = 2 * kMaxEvents;
+  static constexpr uint16 kDroppedEvent = 0xffff;  ///< Marks removed events.
+
+  void nextGeneration();
+  int32 getOffset(int32 index) const;
+  void sortByOffset();
+  KeyState* getKey(int16 channel, int16 pitch);
+  void noteOff(int32 index, KeyState& key);
+  void expressionValue(int32 index);
+
+  Span<Event> events;          ///< Events of the batch, in host order.
+  Span<int32> order;           ///< Event indices by sample offset.
+  Span<int32> offsetCounts;    ///< Counting sort histogram, one block long.
+  Span<int32> previousNoteOn;  ///< Pending NoteOns of a key, newest first.
+  Span<KeyState> keys;
+  Span<ExpressionSlot> expressionSlots;
+
+  uint32 generation = 0;
+  int32 numRead = 0;
+  int32 numKept = 0;
+  bool matchChannel = false;
+};
+
+}  // namespace Radar
+
+#endif  // EVENT_BATCH_H_
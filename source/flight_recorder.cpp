@@ -0,0 +1,425 @@
+/**
+ * @file flight_recorder.cpp
+ *
+ * @brief Implementation of the audio thread flight recorder of the Laser VST
+ * Plugin.
+ *
+ * This file implements the FlightRecorder class declared in
+ * flight_recorder.h.
+ *
+ * @details
+ * Seqlock protocol: the audio thread makes the sequence of a slot odd
+ * before it starts writing the slot and even again once the block is
+ * complete. The worker thread copies a slot only if its sequence was even
+ * before the copy and unchanged after it, so it never keeps a torn record.
+ * Slots overwritten while a dump runs are left out of it.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - POSIX mmap or the Win32 file mapping API
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <vector>
+
+#include "pluginterfaces/base/fplatform.h"
+
+#if SMTG_OS_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Radar {
+
+//-----------------------------------------------------------------------------
+std::string makeUniqueFileName(const char* prefix, const char* extension) {
+  // Shared by every instance of the process, so no two ever count alike
+  static std::atomic<uint32> sequence{0};
+
+  std::tm local = {};
+  std::time_t now = std::time(nullptr);
+#if SMTG_OS_WINDOWS
+  localtime_s(&local, &now);
+  const unsigned long processId = GetCurrentProcessId();
+#else
+  localtime_r(&now, &local);
+  const unsigned long processId = (unsigned long) getpid();
+#endif
+
+  char stamp[32];
+  std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+  return std::string(prefix) + "_" + stamp + "_" +
+         std::to_string(processId) + "_" +
+         std::to_string(sequence.fetch_add(1, std::memory_order_relaxed)) +
+         extension;
+}
+
+/**
+ * @class MappedFile
+ * @brief New file of a fixed size, written through a memory mapping.
+ */
+class MappedFile {
+ public:
+  ~MappedFile() { close(); }
+
+  /// Creates `path` with `size` bytes and maps it, fails if it exists.
+  bool open(const std::filesystem::path& path, size_t size) {
+#if SMTG_OS_WINDOWS
+    file = CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE,
+                       0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL,
+                       nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+                                 (DWORD) ((uint64) size >> 32),
+                                 (DWORD) (size & 0xFFFFFFFF), nullptr);
+    if (!mapping) {
+      return false;
+    }
+    data = static_cast<uint8*>(
+        MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size));
+#else
+    file = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (file < 0 || ftruncate(file, (off_t) size) != 0) {
+      return false;
+    }
+    void* memory =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    data = (memory == MAP_FAILED) ? nullptr : static_cast<uint8*>(memory);
+#endif
+    length = size;
+    return data != nullptr;
+  }
+
+  /// Unmaps and closes the file, the content goes to disk from here.
+  void close() {
+#if SMTG_OS_WINDOWS
+    if (data) {
+      FlushViewOfFile(data, 0);
+      UnmapViewOfFile(data);
+    }
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data) {
+      msync(data, length, MS_ASYNC);
+      munmap(data, length);
+    }
+    if (file >= 0) {
+      ::close(file);
+    }
+    file = -1;
+#endif
+    data = nullptr;
+  }
+
+  uint8* data = nullptr;
+
+ private:
+  size_t length = 0;
+#if SMTG_OS_WINDOWS
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int file = -1;
+#endif
+};
+
+//-----------------------------------------------------------------------------
+// FlightRecorder
+//-----------------------------------------------------------------------------
+void FlightRecorder::start(const ProcessSetup& setup) {
+  stop();
+
+  processSetup = setup;
+  current = nullptr;
+  blockCount = 0;
+  anomalyHoldSamples = 0;
+  blocksWritten.store(0, std::memory_order_relaxed);
+  pendingTrigger.store(kFlightTriggerNone, std::memory_order_relaxed);
+  for (std::atomic<uint32>& sequence : sequences) {
+    sequence.store(0, std::memory_order_relaxed);
+  }
+
+  dumpScheduled = false;
+
+  if (!blocks.data) {
+    return;
+  }
+  RecorderWorker::add(this);
+  started = true;
+}
+
+//-----------------------------------------------------------------------------
+void FlightRecorder::stop() {
+  if (started) {
+    RecorderWorker::remove(this);
+    started = false;
+  }
+  current = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+FlightBlockHeader* FlightRecorder::beginBlock() {
+  if (!blocks.data) {
+    return nullptr;
+  }
+
+  const int32 slot = (int32) (blockCount % kNumBlocks);
+  sequences[slot].store(sequences[slot].load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  current = &blocks[slot];
+  FlightBlockHeader& header = current->header;
+  header.index = blockCount;
+  header.flags = 0;
+  header.numEvents = 0;
+  header.numParamChanges = 0;
+  return &header;
+}
+
+//-----------------------------------------------------------------------------
+void FlightRecorder::addEvent(const Event& event) {
+  if (!current) {
+    return;
+  }
+  FlightBlockHeader& header = current->header;
+  if (header.numEvents < FlightBlock::kMaxEvents) {
+    current->events[header.numEvents++] = event;
+  } else {
+    header.flags |= kFlightEventsDropped;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FlightRecorder::addParamChange(ParamID id, int32 sampleOffset,
+                                    ParamValue value) {
+  if (!current) {
+    return;
+  }
+  FlightBlockHeader& header = current->header;
+  if (header.numParamChanges < FlightBlock::kMaxParamChanges) {
+    current->params[header.numParamChanges++] = {id, sampleOffset, value};
+  } else {
+    header.flags |= kFlightParamsDropped;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FlightRecorder::endBlock(const Sample32* left, const Sample32* right,
+                              int32 numSamples, float load) {
+  if (!current) {
+    return;
+  }
+
+  FlightBlockHeader& header = current->header;
+  float peak = 0.f;
+  for (int32 i = 0; i < numSamples; i++) {
+    peak = std::max(peak, std::max(fabsf(left[i]), fabsf(right[i])));
+  }
+  header.peak = peak;
+  header.load = load;
+  header.outputHash = hashOutput(left, right, numSamples);
+
+  // Output is clamped to full scale, reaching it means it clipped
+  if (peak >= 1.f) {
+    header.flags |= kFlightClipped;
+  }
+  if (load > 1.f) {
+    header.flags |= kFlightOverrun;
+  }
+
+  const int32 slot = (int32) (blockCount % kNumBlocks);
+  sequences[slot].store(sequences[slot].load(std::memory_order_relaxed) + 1,
+                        std::memory_order_release);
+  blocksWritten.store(++blockCount, std::memory_order_release);
+  current = nullptr;
+
+  anomalyHoldSamples -= numSamples;
+  if (anomalyHoldSamples <= 0 &&
+      (header.flags & (kFlightClipped | kFlightOverrun))) {
+    requestDump((header.flags & kFlightClipped) ? kFlightTriggerClip
+                                                : kFlightTriggerOverrun);
+    anomalyHoldSamples = (int64) (kAnomalyHold * processSetup.sampleRate);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FlightRecorder::requestDump(FlightTrigger trigger) {
+  if (!armed) {
+    return;
+  }
+
+  // A pending request wins, its dump will cover this one too
+  uint32 expected = kFlightTriggerNone;
+  pendingTrigger.compare_exchange_strong(expected, trigger,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+uint32 FlightRecorder::hashOutput(const Sample32* left, const Sample32* right,
+                                  int32 numSamples) {
+  // FNV-1a over the bit patterns, so any difference at all shows
+  uint32 hash = 2166136261u;
+  for (int32 i = 0; i < numSamples; i++) {
+    uint32 bits[2];
+    memcpy(&bits[0], &left[i], sizeof(uint32));
+    memcpy(&bits[1], &right[i], sizeof(uint32));
+    hash = (hash ^ bits[0]) * 16777619u;
+    hash = (hash ^ bits[1]) * 16777619u;
+  }
+  return hash;
+}
+
+//-----------------------------------------------------------------------------
+std::string FlightRecorder::getDumpFolder() {
+  std::error_code error;
+  std::filesystem::path folder =
+      std::filesystem::temp_directory_path(error) / "LaserFlight";
+  return folder.string();
+}
+
+//-----------------------------------------------------------------------------
+bool FlightRecorder::poll() {
+  const uint32 trigger = pendingTrigger.load(std::memory_order_acquire);
+  if (trigger == kFlightTriggerNone) {
+    return false;
+  }
+
+  // Let the blocks that follow the trigger into the ring first
+  const auto now = std::chrono::steady_clock::now();
+  if (!dumpScheduled) {
+    dumpScheduled = true;
+    dumpTime = now + std::chrono::duration_cast<
+                         std::chrono::steady_clock::duration>(
+                         std::chrono::duration<double>(kDumpDelay));
+    return true;
+  }
+  if (now < dumpTime) {
+    return true;
+  }
+
+  dumpScheduled = false;
+  pendingTrigger.store(kFlightTriggerNone, std::memory_order_relaxed);
+  dump(trigger);
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+bool FlightRecorder::dump(uint32 trigger) {
+  const uint64 written = blocksWritten.load(std::memory_order_acquire);
+  const uint64 first = (written > kNumBlocks) ? written - kNumBlocks : 0;
+
+  // Copy every complete slot, oldest first. The copy only exists while a
+  // dump is written, instances that never dump never pay for it.
+  std::vector<FlightBlock> snapshot(kNumBlocks);
+  uint32 numBlocks = 0;
+  size_t size = sizeof(FlightDumpHeader);
+  for (uint64 index = first; index < written; index++) {
+    const int32 slot = (int32) (index % kNumBlocks);
+    const uint32 before = sequences[slot].load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+
+    FlightBlock& copy = snapshot[numBlocks];
+    memcpy(&copy, &blocks[slot], sizeof(FlightBlock));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequences[slot].load(std::memory_order_relaxed) != before ||
+        copy.header.index != index) {
+      continue;
+    }
+
+    size += sizeof(FlightBlockHeader) +
+            sizeof(Event) * copy.header.numEvents +
+            sizeof(FlightParamChange) * copy.header.numParamChanges;
+    numBlocks++;
+  }
+  if (numBlocks == 0) {
+    return false;
+  }
+
+  std::error_code error;
+  std::filesystem::path folder = getDumpFolder();
+  std::filesystem::create_directories(folder, error);
+
+  std::filesystem::path path =
+      folder / makeUniqueFileName("laser_flight", ".lfr");
+
+  MappedFile file;
+  if (!file.open(path, size)) {
+    return false;
+  }
+
+  // Replay starts after the last gap, what it cannot reproduce from there
+  uint32 start = 0;
+  for (uint32 i = 1; i < numBlocks; i++) {
+    if (snapshot[i].header.index != snapshot[i - 1].header.index + 1) {
+      start = i;
+    }
+  }
+  uint32 replayLimits = 0;
+  if (snapshot[start].header.index != 0 &&
+      (snapshot[start].header.flags & kFlightEffectsOn)) {
+    replayLimits |= kFlightEffectTails;
+  }
+  for (uint32 i = start; i < numBlocks; i++) {
+    if (snapshot[i].header.flags &
+        (kFlightEventsDropped | kFlightParamsDropped)) {
+      replayLimits |= kFlightInputsTruncated;
+    }
+  }
+
+  FlightDumpHeader dumpHeader;
+  dumpHeader.trigger = trigger;
+  dumpHeader.replayLimits = replayLimits;
+  dumpHeader.numBlocks = numBlocks;
+  dumpHeader.maxSamplesPerBlock = processSetup.maxSamplesPerBlock;
+  dumpHeader.sampleRate = processSetup.sampleRate;
+
+  uint8* out = file.data;
+  memcpy(out, &dumpHeader, sizeof(dumpHeader));
+  out += sizeof(dumpHeader);
+
+  for (uint32 i = 0; i < numBlocks; i++) {
+    const FlightBlock& block = snapshot[i];
+    memcpy(out, &block.header, sizeof(FlightBlockHeader));
+    out += sizeof(FlightBlockHeader);
+    memcpy(out, block.events, sizeof(Event) * block.header.numEvents);
+    out += sizeof(Event) * block.header.numEvents;
+    memcpy(out, block.params,
+           sizeof(FlightParamChange) * block.header.numParamChanges);
+    out += sizeof(FlightParamChange) * block.header.numParamChanges;
+  }
+
+  file.close();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+}  // namespace Radar
@@ -0,0 +1,286 @@
+/**
+ * @file flight_recorder.h
+ *
+ * @brief Audio thread flight recorder of the Laser VST Plugin.
+ *
+ * This file defines the FlightRecorder class, which keeps the inputs, the
+ * DSP state and the timing of the last kNumBlocks processed blocks, and the
+ * binary dump format it writes them in.
+ *
+ * @details
+ * Every block the processor fills one FlightBlock in a ring carved from its
+ * arena: the DSP state at the start of the block, the events and parameter
+ * changes it received, and, when done, the time it took and a hash and the
+ * peak of its output. Nothing is allocated and nothing blocks: each slot is
+ * guarded by a sequence counter (a seqlock), so the worker thread can copy the
+ * ring while the audio thread keeps writing and simply skips the one slot
+ * that is being written.
+ *
+ * A dump is requested by setting an atomic trigger, either when the
+ * controller switches the dump parameter on or on an anomaly: clipped
+ * output or a block that overran its deadline. The RecorderWorker picks the
+ * trigger up, lets a few more blocks pass so the dump shows what followed,
+ * copies the ring and writes it to a memory-mapped file in the temporary
+ * directory. Automatic dumps are rate limited to one per kAnomalyHold. The
+ * copy of the ring is only allocated for the dump, on the worker thread.
+ * File names carry the process ID and a counter shared by all instances of
+ * the process, and files are only ever created, never truncated, so
+ * instances dumping at the same moment cannot write into each other's dump.
+ *
+ * A dump replays bit exactly from the first block after its last gap unless
+ * FlightDumpHeader::replayLimits says otherwise: the delay and chorus lines
+ * are not recorded, so a replay starting mid-session with an effect running
+ * misses its tail, and a block with more events or parameter changes than a
+ * slot holds replays without the excess.
+ *
+ * File layout: one FlightDumpHeader, then numBlocks records, oldest first.
+ * Each record is a FlightBlockHeader followed by its numEvents Events and
+ * numParamChanges FlightParamChanges. All values are in host byte order.
+ *
+ * Features:
+ * - Allocation free, wait-free recording on the audio thread.
+ * - Anomaly triggered and on-demand dumps.
+ * - Compact dumps, written through a memory mapping off the audio thread.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "arena.h"
+#include "recorder_worker.h"
+#include "voice.h"
+
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+#include "pluginterfaces/vst/ivstevents.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/**
+ * @enum FlightTrigger
+ * @brief Why a dump was written.
+ */
+enum FlightTrigger : uint32 {
+  kFlightTriggerNone = 0,
+  kFlightTriggerUser,     ///< Requested through the controller.
+  kFlightTriggerClip,     ///< The output clipped.
+  kFlightTriggerOverrun   ///< A block took longer than its deadline.
+};
+
+/**
+ * @enum FlightBlockFlags
+ * @brief Anomalies and truncations of a recorded block.
+ */
+enum FlightBlockFlags : uint32 {
+  kFlightClipped = 1 << 0,         ///< Output reached full scale.
+  kFlightOverrun = 1 << 1,         ///< Processing exceeded the deadline.
+  kFlightEventsDropped = 1 << 2,   ///< More than kMaxEvents events.
+  kFlightParamsDropped = 1 << 3,   ///< More than kMaxParamChanges changes.
+  kFlightEffectsOn = 1 << 4        ///< Chorus or delay ran into the block.
+};
+
+/**
+ * @enum FlightReplayLimits
+ * @brief Why a dump does not replay bit exactly.
+ */
+enum FlightReplayLimits : uint32 {
+  kFlightEffectTails = 1 << 0,     ///< Starts mid-session, an effect on.
+  kFlightInputsTruncated = 1 << 1  ///< A block lost inputs.
+};
+
+/**
+ * @brief Returns a file name no other recorder of any instance in any
+ * process uses: `prefix`, the local time, the process ID, a per-process
+ * sequence number and `extension`.
+ */
+std::string makeUniqueFileName(const char* prefix, const char* extension);
+
+/**
+ * @struct FlightParamChange
+ * @brief The parameter value a block applied, with its sample offset.
+ */
+struct FlightParamChange {
+  ParamID id;
+  int32 sampleOffset;
+  ParamValue value;
+};
+
+/**
+ * @struct FlightBlockHeader
+ * @brief Fixed part of a recorded block.
+ */
+struct FlightBlockHeader {
+  static constexpr int32 kMaxVoices = 16;       ///< Voices of a processor.
+  static constexpr int32 kMaxStateValues = 64;  ///< Room for the state.
+  static constexpr int32 kMaxRamps = 8;         ///< Parameter ramps.
+
+  uint64 index = 0;               ///< Blocks processed since activation.
+  int64 projectTimeSamples = 0;   ///< Host position, if it sent one.
+  double tempo = 0.;              ///< Host tempo, 0 if it sent none.
+  uint32 contextState = 0;        ///< ProcessContext state, 0 without one.
+  uint32 wasPlaying = 0;          ///< Transport played before the block.
+  float bypassGain = 1.f;         ///< Bypass crossfade gain.
+  int32 numSamples = 0;           ///< Block size.
+  uint32 flags = 0;               ///< FlightBlockFlags.
+  uint32 groupBuses = 0;          ///< Voice groups on their own bus.
+  int32 governorLevel = 0;        ///< Quality level during the block.
+  float load = 0.f;               ///< Time spent / deadline.
+  float peak = 0.f;               ///< Output peak after clipping.
+  uint32 outputHash = 0;          ///< hashOutput() of the block.
+  int32 numEvents = 0;            ///< Events recorded.
+  int32 numParamChanges = 0;      ///< Parameter changes recorded.
+  int32 numStateValues = 0;       ///< Entries used in `state`.
+  double lfoPhases[2] = {};       ///< Modulation LFO phases.
+  float chorusPhase = 0.f;        ///< Chorus LFO phase.
+  float state[kMaxStateValues] = {};  ///< Parameters, in state order.
+  float rampValues[kMaxRamps] = {};   ///< Current values of the ramps.
+  float rampTargets[kMaxRamps] = {};  ///< Targets, not all are in `state`.
+  uint32 pedals = 0;           ///< Bit 0 sustain, bit 1 sostenuto down.
+  uint32 pedalHeldVoices = 0;  ///< Voices only a pedal keeps sounding.
+  uint32 sostenutoVoices = 0;  ///< Voices latched by the sostenuto.
+
+  // Voices and their expression lanes at the start of the block
+  Voice voices[kMaxVoices];
+  VoiceExpression expressions[kMaxVoices];
+};
+
+/**
+ * @struct FlightBlock
+ * @brief One slot of the recorder ring.
+ */
+struct FlightBlock {
+  static constexpr int32 kMaxEvents = 32;        ///< Events kept per block.
+  static constexpr int32 kMaxParamChanges = 32;  ///< Changes kept per block.
+
+  FlightBlockHeader header;
+  Event events[kMaxEvents];
+  FlightParamChange params[kMaxParamChanges];
+};
+
+/**
+ * @struct FlightDumpHeader
+ * @brief Start of a dump file.
+ */
+struct FlightDumpHeader {
+  static constexpr uint32 kMagic = 0x3152464C;  ///< "LFR1".
+  static constexpr uint32 kVersion = 9;  ///< 9: Replay limits.
+
+  uint32 magic = kMagic;
+  uint32 version = kVersion;
+  uint32 blockHeaderSize = sizeof(FlightBlockHeader);  ///< Layout check.
+  uint32 eventSize = sizeof(Event);                    ///< Layout check.
+  uint32 paramChangeSize = sizeof(FlightParamChange);  ///< Layout check.
+  uint32 trigger = kFlightTriggerNone;  ///< FlightTrigger.
+  uint32 replayLimits = 0;              ///< FlightReplayLimits, 0 if exact.
+  uint32 numBlocks = 0;                 ///< Records following the header.
+  int32 maxSamplesPerBlock = 0;
+  double sampleRate = 0.;
+};
+
+/**
+ * @class FlightRecorder
+ * @brief Ring of the last kNumBlocks blocks and the task that dumps it.
+ */
+class FlightRecorder : public RecorderTask {
+ public:
+  static constexpr int32 kNumBlocks = 512;     ///< Blocks kept.
+  static constexpr double kDumpDelay = 0.1;    ///< Blocks after a trigger, s.
+  static constexpr double kAnomalyHold = 5.;   ///< Between automatic dumps.
+
+  FlightRecorder() = default;
+  ~FlightRecorder() override { stop(); }
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  /// Carves the ring from `arena`.
+  void carve(Arena& arena) { blocks = arena.carve<FlightBlock>(kNumBlocks); }
+
+  /**
+   * @brief Empties the ring and adds the recorder to the RecorderWorker.
+   *
+   * Called from setActive(true), after the ring was carved.
+   */
+  void start(const ProcessSetup& setup);
+
+  /// Removes the recorder from the RecorderWorker. Called from
+  /// setActive(false).
+  void stop();
+
+  /// Writes a requested dump once kDumpDelay passed, on the worker thread.
+  bool poll() override;
+
+  /// Whether dumps are requested at all, on by default. Replay turns it off.
+  void setArmed(bool state) { armed = state; }
+
+  /**
+   * @brief Starts recording a block.
+   *
+   * @return The slot to fill, nullptr while the ring is not carved.
+   */
+  FlightBlockHeader* beginBlock();
+
+  /// Records an event of the current block.
+  void addEvent(const Event& event);
+
+  /// Records a parameter change of the current block.
+  void addParamChange(ParamID id, int32 sampleOffset, ParamValue value);
+
+  /**
+   * @brief Finishes the current block from its final output and timing,
+   * and triggers a dump on anomalies.
+   */
+  void endBlock(const Sample32* left, const Sample32* right,
+                int32 numSamples, float load);
+
+  /// Requests a dump, from the audio thread.
+  void requestDump(FlightTrigger trigger);
+
+  /// Hash of a block of output, bit exact.
+  static uint32 hashOutput(const Sample32* left, const Sample32* right,
+                           int32 numSamples);
+
+  /// Folder the dumps are written to.
+  static std::string getDumpFolder();
+
+ private:
+  /// Copies the ring and writes it to a new dump file.
+  bool dump(uint32 trigger);
+
+  // Audio thread
+  Span<FlightBlock> blocks;
+  FlightBlock* current = nullptr;
+  uint64 blockCount = 0;
+  int64 anomalyHoldSamples = 0;  ///< Samples until anomalies dump again.
+  bool armed = true;
+
+  // Shared
+  std::atomic<uint32> sequences[kNumBlocks] = {};  ///< Seqlock per slot.
+  std::atomic<uint64> blocksWritten{0};
+  std::atomic<uint32> pendingTrigger{kFlightTriggerNone};
+
+  // Worker thread
+  bool started = false;  ///< Added to the RecorderWorker.
+  bool dumpScheduled = false;
+  std::chrono::steady_clock::time_point dumpTime;  ///< When to dump.
+  ProcessSetup processSetup = {};
+};
+
+}  // namespace Radar
+
+#endif  // FLIGHT_RECORDER_H_
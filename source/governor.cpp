@@ -0,0 +1,83 @@
+/**
+ * @file governor.cpp
+ *
+ * @brief Implementation of the adaptive quality governor of the Laser VST
+ * Plugin.
+ *
+ * This file implements the QualityGovernor class declared in governor.h.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - Standard Math Library (math.h)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "governor.h"
+
+#include <cmath>
+
+namespace Radar {
+
+//-----------------------------------------------------------------------------
+void QualityGovernor::setup(SampleRate newSampleRate) {
+  sampleRate = newSampleRate;
+  reset();
+}
+
+//-----------------------------------------------------------------------------
+void QualityGovernor::reset() {
+  load = 0.f;
+  level = 0;
+  overruns = 0;
+  holdTime = 0.;
+  headroomTime = 0.;
+  reportTime = 0.;
+}
+
+//-----------------------------------------------------------------------------
+bool QualityGovernor::update(double elapsedSeconds, int32 numSamples) {
+  if (numSamples <= 0) {
+    return false;
+  }
+
+  const double deadline = numSamples / sampleRate;
+  const float blockLoad = (float) (elapsedSeconds / deadline);
+
+  // Average over kSmoothingTime regardless of the block size
+  const float coefficient = (float) (1. - exp(-deadline / kSmoothingTime));
+  load += (blockLoad - load) * coefficient;
+
+  holdTime -= deadline;
+  reportTime += deadline;
+  overruns = (blockLoad > 1.f) ? overruns + 1 : 0;
+
+  const int32 previousLevel = level;
+  if ((load > kHighLoad || overruns >= kOverrunsToStep) && holdTime <= 0. &&
+      level < kNumLevels - 1) {
+    level++;
+    holdTime = kStepDownHold;
+    headroomTime = 0.;
+  } else if (load < kLowLoad) {
+    headroomTime += deadline;
+    if (headroomTime >= kRecoverTime && level > 0) {
+      level--;
+      headroomTime = 0.;
+    }
+  } else {
+    headroomTime = 0.;
+  }
+
+  if (level != previousLevel || reportTime >= kReportInterval) {
+    reportTime = 0.;
+    return true;
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+}  // namespace Radar
@@ -0,0 +1,111 @@
+/**
+ * @file governor.h
+ *
+ * @brief Adaptive quality governor of the Laser VST Plugin.
+ *
+ * This file defines the QualityGovernor class, which watches how much of
+ * each block's real-time budget process() uses and lowers the polyphony of
+ * the processor when the budget is at risk.
+ *
+ * @details
+ * The load of a block is the time spent in process() divided by the block
+ * deadline (numSamples / sampleRate). The governor smooths it and steps the
+ * quality level down when the smoothed load exceeds kHighLoad, or when
+ * kOverrunsToStep blocks in a row overran their deadline. A single overrun
+ * is more often a preempted thread or a page fault than a lack of budget,
+ * and costs notes for nothing. After a step down it waits
+ * kStepDownHold before judging again, so the effect of the step is measured
+ * first. It steps back up only after the load stayed below kLowLoad for
+ * kRecoverTime; the gap between the two thresholds is the hysteresis that
+ * keeps it from oscillating.
+ *
+ * Laser has no unison or oversampling to trade, so the quality levels are
+ * polyphony limits. Voices above the limit are stolen, quietest first, with
+ * a short fade.
+ *
+ * Features:
+ * - Per-block load measurement against the real-time deadline.
+ * - Smoothed, hysteretic quality level.
+ * - Rate-limited diagnostics for the controller.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - Standard Math Library (math.h)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef GOVERNOR_H_
+#define GOVERNOR_H_
+
+#include "pluginterfaces/vst/vsttypes.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/**
+ * @class QualityGovernor
+ * @brief Maps the measured DSP load onto a quality level.
+ */
+class QualityGovernor {
+ public:
+  static constexpr int32 kNumLevels = 4;         ///< Level 0 is full quality.
+  static constexpr float kHighLoad = 0.7f;       ///< Step down above.
+  static constexpr float kLowLoad = 0.35f;       ///< Step up below.
+  static constexpr double kSmoothingTime = 0.05;   ///< Load average, s.
+  static constexpr double kStepDownHold = 0.1;     ///< After a change, s.
+  static constexpr double kRecoverTime = 1.0;      ///< Headroom needed, s.
+  static constexpr double kReportInterval = 0.1;   ///< Diagnostics rate, s.
+  static constexpr int32 kOverrunsToStep = 3;      ///< Overruns in a row.
+
+  /// Polyphony limit of each quality level.
+  static constexpr int32 kMaxVoices[kNumLevels] = {8, 6, 4, 2};
+
+  /// Sets the sample rate the deadlines are computed for.
+  void setup(SampleRate newSampleRate);
+
+  /// Back to full quality and no load history.
+  void reset();
+
+  /**
+   * @brief Feeds the time spent processing a block of `numSamples`.
+   *
+   * @return true when the diagnostics should be reported: the level changed
+   * or kReportInterval passed since the last report.
+   */
+  bool update(double elapsedSeconds, int32 numSamples);
+
+  /// Sets the quality level directly, for offline replay.
+  void forceLevel(int32 newLevel) {
+    level = newLevel < 0 ? 0 : (newLevel < kNumLevels ? newLevel
+                                                       : kNumLevels - 1);
+  }
+
+  /// Current quality level, 0 is full quality.
+  int32 getLevel() const { return level; }
+
+  /// Polyphony allowed at the current level.
+  int32 getMaxVoices() const { return kMaxVoices[level]; }
+
+  /// Smoothed load, 1 means the whole block deadline was used.
+  float getLoad() const { return load; }
+
+ private:
+  SampleRate sampleRate = 44100.;
+  float load = 0.f;
+  int32 level = 0;
+  int32 overruns = 0;        ///< Consecutive blocks over their deadline.
+  double holdTime = 0.;      ///< Time left before the next step down.
+  double headroomTime = 0.;  ///< Time spent below kLowLoad.
+  double reportTime = 0.;    ///< Time since the last report.
+};
+
+}  // namespace Radar
+
+#endif  // GOVERNOR_H_
@@ -15,10 +15,12 @@
  * interface for GUI integration.
  *
  * Features:
- * - Parameter management for gain and oscillators.
+ * - Parameters registered, converted and formatted from the parameter
+ *   table.
  * - Synchronization with the processor's state.
  * - Support for GUI integration using VSTGUI.
  * - Saving and restoring parameter states.
+ * - Scope view fed by the output capture of the processor.
  *
  * Dependencies:
  * - Steinberg VST3 SDK
@@ -33,15 +35,23 @@
 
 #include "laser_controller.h"
 
+#include <cstring>
+
 #include "base/source/fstreamer.h"
 #include "laser_cids.h"
-#include "params.h"
+#include "param_table.h"
+#include "scope_view.h"
+#include "table_parameter.h"
 
 #include "pluginterfaces/base/ibstream.h"
+#include "public.sdk/source/vst/vstparameters.h"
 #include "vstgui/plugin-bindings/vst3editor.h"
 
 namespace Radar {
 
+// Tag of the controller state, followed by ID/value pairs
+static const int32 kControllerStateVersion = 1;
+
 //------------------------------------------------------------------------
 // LaserController Implementation
 //------------------------------------------------------------------------
@@ -54,23 +64,29 @@ tresult PLUGIN_API LaserController::initialize(FUnknown* context) {
     return result;
   }
 
-  parameters.addParameter(STR16("WAVE"), STR16("Form"), 3, default_WaveType,
-                          Vst::ParameterInfo::kCanAutomate,
-                          WaveParams::kWaveForm);
-
-  // Create Parameters
-  parameters.addParameter(STR16("GAIN"), STR16("dB"), 0, default_Gain,
-                          Vst::ParameterInfo::kCanAutomate,
-                          GainParams::kParamGainId);
-
+  // Every parameter is described by a row of the table, see param_table.h
   setKnobMode(Vst::kLinearMode);
-  parameters.addParameter(STR16("OSC1"), STR16("Hz"), 0, default_Osc1,
-                          Vst::ParameterInfo::kCanAutomate,
-                          FrequencyParams::kOsc1);
+  for (const ParamSpec& spec : kParamTable) {
+    parameters.addParameter(new TableParameter(spec));
+  }
 
-  parameters.addParameter(STR16("OSC2"), STR16("Hz"), 0, default_Osc2,
-                          Vst::ParameterInfo::kCanAutomate,
-                          FrequencyParams::kOsc2);
+  // Per-note expressions, value ranges as defined by the VST3 spec
+  noteExpressionTypes.addNoteExpressionType(new NoteExpressionType(
+      kVolumeTypeID, STR16("Volume"), STR16("Vol"), STR16("%"), -1, 0.25, 0.,
+      1., 0, NoteExpressionTypeInfo::kIsAbsolute));
+  noteExpressionTypes.addNoteExpressionType(new NoteExpressionType(
+      kPanTypeID, STR16("Pan"), STR16("Pan"), STR16(""), -1, 0.5, 0., 1., 0,
+      NoteExpressionTypeInfo::kIsBipolar |
+          NoteExpressionTypeInfo::kIsAbsolute));
+  noteExpressionTypes.addNoteExpressionType(new RangeNoteExpressionType(
+      kTuningTypeID, STR16("Tuning"), STR16("Tun"), STR16("Half Tone"), -1, 0.,
+      -120., 120., NoteExpressionTypeInfo::kIsBipolar));
+  noteExpressionTypes.addNoteExpressionType(new NoteExpressionType(
+      kBrightnessTypeID, STR16("Brightness"), STR16("Brt"), STR16(""), -1, 0.5,
+      0., 1., 0, NoteExpressionTypeInfo::kIsBipolar));
+  noteExpressionTypes.addNoteExpressionType(new NoteExpressionType(
+      kExpressionTypeID, STR16("Pressure"), STR16("Prs"), STR16("%"), -1, 0.,
+      0., 1., 0, NoteExpressionTypeInfo::kIsAbsolute));
 
   return result;
 }
@@ -80,6 +96,8 @@ tresult PLUGIN_API LaserController::terminate() {
   // Here the Plug-in will be de-instantiated, last possibility to remove some
   // memory!
 
+  noteExpressionTypes.removeAll();
+
   //---do not forget to call parent ------
   return EditControllerEx1::terminate();
 }
@@ -93,50 +111,88 @@ tresult PLUGIN_API LaserController::setComponentState(IBStream* state) {
 
   IBStreamer streamer(state, kLittleEndian);
 
-  float fval;
-
-  if (streamer.readFloat(fval) == false) {
-    return kResultFalse;
+  // Parameters in state order, as LaserProcessor::getState() writes them.
+  // Older states end early and keep the defaults of the rest.
+  int32 count = 0;
+  float value = 0.f;
+  while (count < kNumStateParams && streamer.readFloat(value)) {
+    const ParamSpec& spec = kParamTable[kStateOrder[count++]];
+    setParamNormalized(spec.id, fromStateValue(spec, value));
   }
-
-  setParamNormalized(kWaveForm, fval);
-
-  float savedParamGain = 0.f;
-  if (streamer.readFloat(savedParamGain) == false) {
+  if (count < kNumRequiredStateParams) {
     return kResultFalse;
   }
 
-  // sync with our parameter
-  if (auto param = parameters.getParameter(GainParams::kParamGainId)) {
-    param->setNormalized(savedParamGain);
-  }
+  return kResultOk;
+}
 
-  if (streamer.readFloat(fval) == false) {
+//------------------------------------------------------------------------
+tresult PLUGIN_API LaserController::setState(IBStream* state) {
+  // Here you get the state of the controller
+  if (!state) {
     return kResultFalse;
   }
 
-  setParamNormalized(kOsc1, fval);
+  IBStreamer streamer(state, kLittleEndian);
 
-  if (streamer.readFloat(fval) == false) {
+  int32 version = 0;
+  int32 count = 0;
+  if (!streamer.readInt32(version) || version != kControllerStateVersion ||
+      !streamer.readInt32(count)) {
     return kResultFalse;
   }
 
-  setParamNormalized(kOsc2, fval);
+  // Values are tagged with their ID, parameters removed since are skipped
+  for (int32 i = 0; i < count; i++) {
+    uint32 id = 0;
+    double value = 0.;
+    if (!streamer.readInt32u(id) || !streamer.readDouble(value)) {
+      return kResultFalse;
+    }
+    const int32 index = paramIndex(id);
+    if (index >= 0 && kParamTable[index].stateIndex >= 0) {
+      setParamNormalized(id, value);
+    }
+  }
 
-  return kResultOk;
+  return kResultTrue;
 }
 
 //------------------------------------------------------------------------
-tresult PLUGIN_API LaserController::setState(IBStream* state) {
-  // Here you get the state of the controller
+tresult PLUGIN_API LaserController::setParamNormalized(ParamID tag,
+                                                       ParamValue value) {
+  if (tag != kMpeZone) {
+    return EditControllerEx1::setParamNormalized(tag, value);
+  }
 
-  return kResultTrue;
+  const ParamSpec& spec = kParamTable[paramIndex(kMpeZone)];
+  const int32 zone = toStep(spec, getParamNormalized(kMpeZone));
+  const tresult result = EditControllerEx1::setParamNormalized(tag, value);
+  if (componentHandler &&
+      toStep(spec, getParamNormalized(kMpeZone)) != zone) {
+    componentHandler->restartComponent(kMidiCCAssignmentChanged);
+  }
+  return result;
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API LaserController::getState(IBStream* state) {
   // Here you are asked to deliver the state of the controller (if needed)
-  // Note: the real state of your plug-in is saved in the processor
+  // Note: the real state of your plug-in is saved in the processor. The
+  // controller keeps its view of the stored parameters, by ID, for hosts
+  // that restore the controller on its own.
+  if (!state) {
+    return kResultFalse;
+  }
+
+  IBStreamer streamer(state, kLittleEndian);
+  streamer.writeInt32(kControllerStateVersion);
+  streamer.writeInt32(kNumStateParams);
+  for (int16 index : kStateOrder) {
+    const ParamID id = kParamTable[index].id;
+    streamer.writeInt32u(id);
+    streamer.writeDouble(getParamNormalized(id));
+  }
 
   return kResultTrue;
 }
@@ -152,5 +208,191 @@ IPlugView* PLUGIN_API LaserController::createView(FIDString name) {
   return nullptr;
 }
 
+//------------------------------------------------------------------------
+tresult PLUGIN_API LaserController::notify(IMessage* message) {
+  if (scopeReceiver.onMessage(message)) {
+    return kResultTrue;
+  }
+  return EditControllerEx1::notify(message);
+}
+
+//------------------------------------------------------------------------
+void LaserController::sendScopeEnabled(bool enabled) {
+  if (IPtr<IMessage> message = owned(allocateMessage())) {
+    message->setMessageID(kScopeEnableMessageID);
+    message->getAttributes()->setInt(kScopeEnabledAttribute, enabled ? 1 : 0);
+    sendMessage(message);
+  }
+}
+
+//------------------------------------------------------------------------
+// VST3EditorDelegate
+//------------------------------------------------------------------------
+VSTGUI::CView* LaserController::createCustomView(
+    VSTGUI::UTF8StringPtr name, const VSTGUI::UIAttributes& /*attributes*/,
+    const VSTGUI::IUIDescription* /*description*/,
+    VSTGUI::VST3Editor* /*editor*/) {
+  // Origin and size are applied from the description afterwards
+  if (name && strcmp(name, "ScopeView") == 0) {
+    return new ScopeView(VSTGUI::CRect(0, 0, 1, 1), scopeHistory);
+  }
+  return nullptr;
+}
+
+//------------------------------------------------------------------------
+void LaserController::didOpen(VSTGUI::VST3Editor* /*editor*/) {
+  if (openEditors++ == 0) {
+    sendScopeEnabled(true);
+  }
+}
+
+//------------------------------------------------------------------------
+void LaserController::willClose(VSTGUI::VST3Editor* /*editor*/) {
+  if (--openEditors == 0) {
+    sendScopeEnabled(false);
+  }
+}
+
+//------------------------------------------------------------------------
+// IDataExchangeReceiver
+//------------------------------------------------------------------------
+void PLUGIN_API LaserController::queueOpened(
+    DataExchangeUserContextID /*userContextID*/, uint32 /*blockSize*/,
+    TBool& dispatchOnBackgroundThread) {
+  // ScopeHistory is only ever touched on the UI thread
+  dispatchOnBackgroundThread = false;
+}
+
+//------------------------------------------------------------------------
+void PLUGIN_API
+LaserController::queueClosed(DataExchangeUserContextID /*userContextID*/) {}
+
+//------------------------------------------------------------------------
+void PLUGIN_API LaserController::onDataExchangeBlocksReceived(
+    DataExchangeUserContextID /*userContextID*/, uint32 numBlocks,
+    DataExchangeBlock* blocks, TBool /*onBackgroundThread*/) {
+  for (uint32 i = 0; i < numBlocks; i++) {
+    if (blocks[i].size >= sizeof(ScopeBlock)) {
+      scopeHistory.write(*static_cast<const ScopeBlock*>(blocks[i].data));
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+// INoteExpressionController
+//------------------------------------------------------------------------
+int32 PLUGIN_API LaserController::getNoteExpressionCount(int32 busIndex,
+                                                         int16 /*channel*/) {
+  // Same expressions on every channel of the single event bus
+  if (busIndex == 0) {
+    return noteExpressionTypes.getNoteExpressionCount();
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API LaserController::getNoteExpressionInfo(
+    int32 busIndex, int16 /*channel*/, int32 noteExpressionIndex,
+    NoteExpressionTypeInfo& info) {
+  if (busIndex == 0) {
+    return noteExpressionTypes.getNoteExpressionInfo(noteExpressionIndex,
+                                                     info);
+  }
+  return kResultFalse;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API LaserController::getNoteExpressionStringByValue(
+    int32 /*busIndex*/, int16 /*channel*/, NoteExpressionTypeID id,
+    NoteExpressionValue valueNormalized, String128 string) {
+  return noteExpressionTypes.getNoteExpressionStringByValue(
+      id, valueNormalized, string);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API LaserController::getNoteExpressionValueByString(
+    int32 /*busIndex*/, int16 /*channel*/, NoteExpressionTypeID id,
+    const TChar* string, NoteExpressionValue& valueNormalized) {
+  return noteExpressionTypes.getNoteExpressionValueByString(id, string,
+                                                            valueNormalized);
+}
+
+//------------------------------------------------------------------------
+// INoteExpressionPhysicalUIMapping
+//------------------------------------------------------------------------
+tresult PLUGIN_API LaserController::getPhysicalUIMapping(
+    int32 busIndex, int16 /*channel*/, PhysicalUIMapList& list) {
+  // The usual MPE dimensions: per-note pitch bend (X) to tuning, slide (Y,
+  // CC74) to brightness and pressure to the pressure expression, which
+  // unlike volume does not silence notes played without pressure
+  if (busIndex != 0) {
+    return kResultFalse;
+  }
+
+  for (uint32 i = 0; i < list.count; i++) {
+    switch (list.map[i].physicalUITypeID) {
+      case kPUIXMovement:
+        list.map[i].noteExpressionTypeID = kTuningTypeID;
+        break;
+
+      case kPUIYMovement:
+        list.map[i].noteExpressionTypeID = kBrightnessTypeID;
+        break;
+
+      case kPUIPressure:
+        list.map[i].noteExpressionTypeID = kExpressionTypeID;
+        break;
+
+      default:
+        list.map[i].noteExpressionTypeID = kInvalidTypeID;
+        break;
+    }
+  }
+  return kResultTrue;
+}
+
+//------------------------------------------------------------------------
+// IMidiMapping
+//------------------------------------------------------------------------
+tresult PLUGIN_API LaserController::getMidiControllerAssignment(
+    int32 busIndex, int16 channel, CtrlNumber midiControllerNumber,
+    ParamID& id) {
+  if (busIndex != 0) {
+    return kResultFalse;
+  }
+
+  // Pedals and the wheel act on every note, in an MPE zone they come on its
+  // master channel; per-note bends on the member channels are expressions
+  switch (toStep(kParamTable[paramIndex(kMpeZone)],
+                 getParamNormalized(kMpeZone))) {
+    case kMpeLowerZone:
+      if (channel != 0) {
+        return kResultFalse;
+      }
+      break;
+
+    case kMpeUpperZone:
+      if (channel != 15) {
+        return kResultFalse;
+      }
+      break;
+  }
+
+  switch (midiControllerNumber) {
+    case kCtrlSustainOnOff:
+      id = kSustainPedal;
+      return kResultTrue;
+
+    case kCtrlSustenutoOnOff:
+      id = kSostenutoPedal;
+      return kResultTrue;
+
+    case kPitchBend:
+      id = kPitchWheel;
+      return kResultTrue;
+  }
+  return kResultFalse;
+}
+
 //------------------------------------------------------------------------
 }  // namespace Radar
@@ -18,6 +18,12 @@
  * - Synchronization with processor state for consistency.
  * - GUI integration using VSTGUI for user-friendly controls.
  * - Supports saving and restoring parameter states.
+ * - Note expressions and MPE physical UI mapping for expressive
+ *   controllers.
+ * - MIDI mapping of the sustain and sostenuto pedals and the pitch bend
+ *   wheel, on the master channel of an MPE zone.
+ * - Receives the output capture of the processor for the scope view, only
+ *   while an editor is open.
  *
  * Dependencies:
  * - Steinberg VST3 SDK
@@ -33,8 +39,14 @@
 #ifndef LASER_CONTROLLER_H_
 #define LASER_CONTROLLER_H_
 
+#include "scope.h"
+
 #include "public.sdk/source/vst/vsteditcontroller.h"
+#include "public.sdk/source/vst/vstnoteexpressiontypes.h"
+#include "pluginterfaces/vst/ivstdataexchange.h"
 #include "pluginterfaces/vst/ivstmidicontrollers.h"
+#include "pluginterfaces/vst/ivstnoteexpression.h"
+#include "vstgui/plugin-bindings/vst3editor.h"
 
 using namespace Steinberg;
 using namespace Vst;
@@ -47,7 +59,12 @@ namespace Radar {
  *
  * This class manages parameters and GUI interactions for the Laser VST Plugin.
  */
-class LaserController : public EditControllerEx1 {
+class LaserController : public EditControllerEx1,
+                        public INoteExpressionController,
+                        public INoteExpressionPhysicalUIMapping,
+                        public IMidiMapping,
+                        public IDataExchangeReceiver,
+                        public VSTGUI::VST3EditorDelegate {
  public:
   LaserController() = default;                 ///< Constructor.
   ~LaserController() SMTG_OVERRIDE = default;  ///< Destructor.
@@ -66,16 +83,83 @@ class LaserController : public EditControllerEx1 {
   tresult PLUGIN_API setState(IBStream* state) SMTG_OVERRIDE;
   tresult PLUGIN_API getState(IBStream* state) SMTG_OVERRIDE;
 
+  /// Also tells the host to query the MIDI mapping again when the MPE zone
+  /// changes, the channels the controllers are mapped on move with it.
+  tresult PLUGIN_API setParamNormalized(ParamID tag,
+                                        ParamValue value) SMTG_OVERRIDE;
+
   // GUI handling
   IPlugView* PLUGIN_API createView(FIDString name) SMTG_OVERRIDE;
 
+  // Messages from the processor
+  tresult PLUGIN_API notify(IMessage* message) SMTG_OVERRIDE;
+
+  // VST3EditorDelegate
+  VSTGUI::CView* createCustomView(VSTGUI::UTF8StringPtr name,
+                                  const VSTGUI::UIAttributes& attributes,
+                                  const VSTGUI::IUIDescription* description,
+                                  VSTGUI::VST3Editor* editor) override;
+  void didOpen(VSTGUI::VST3Editor* editor) override;
+  void willClose(VSTGUI::VST3Editor* editor) override;
+
+  // IDataExchangeReceiver
+  void PLUGIN_API queueOpened(DataExchangeUserContextID userContextID,
+                              uint32 blockSize,
+                              TBool& dispatchOnBackgroundThread)
+      SMTG_OVERRIDE;
+  void PLUGIN_API queueClosed(DataExchangeUserContextID userContextID)
+      SMTG_OVERRIDE;
+  void PLUGIN_API onDataExchangeBlocksReceived(
+      DataExchangeUserContextID userContextID, uint32 numBlocks,
+      DataExchangeBlock* blocks, TBool onBackgroundThread) SMTG_OVERRIDE;
+
+  // INoteExpressionController
+  int32 PLUGIN_API getNoteExpressionCount(int32 busIndex,
+                                          int16 channel) SMTG_OVERRIDE;
+  tresult PLUGIN_API getNoteExpressionInfo(
+      int32 busIndex, int16 channel, int32 noteExpressionIndex,
+      NoteExpressionTypeInfo& info) SMTG_OVERRIDE;
+  tresult PLUGIN_API getNoteExpressionStringByValue(
+      int32 busIndex, int16 channel, NoteExpressionTypeID id,
+      NoteExpressionValue valueNormalized, String128 string) SMTG_OVERRIDE;
+  tresult PLUGIN_API getNoteExpressionValueByString(
+      int32 busIndex, int16 channel, NoteExpressionTypeID id,
+      const TChar* string, NoteExpressionValue& valueNormalized) SMTG_OVERRIDE;
+
+  // INoteExpressionPhysicalUIMapping
+  tresult PLUGIN_API getPhysicalUIMapping(int32 busIndex, int16 channel,
+                                          PhysicalUIMapList& list)
+      SMTG_OVERRIDE;
+
+  // IMidiMapping
+  tresult PLUGIN_API getMidiControllerAssignment(
+      int32 busIndex, int16 channel, CtrlNumber midiControllerNumber,
+      ParamID& id) SMTG_OVERRIDE;
+
   // Interface handling
   DEFINE_INTERFACES
-  END_DEFINE_INTERFACES(EditController)
-  DELEGATE_REFCOUNT(EditController)
+    DEF_INTERFACE(INoteExpressionController)
+    DEF_INTERFACE(INoteExpressionPhysicalUIMapping)
+    DEF_INTERFACE(IMidiMapping)
+    DEF_INTERFACE(IDataExchangeReceiver)
+  END_DEFINE_INTERFACES(EditControllerEx1)
+  DELEGATE_REFCOUNT(EditControllerEx1)
 
  protected:
-  // Protected methods and members can be added here
+  /// Asks the processor to start or stop capturing for the scope.
+  void sendScopeEnabled(bool enabled);
+
+  /// Note expressions understood by the processor.
+  NoteExpressionTypeContainer noteExpressionTypes;
+
+  /// Receives the capture blocks, by host queue or by message.
+  DataExchangeReceiverHandler scopeReceiver{this};
+
+  /// Captured samples shown by the ScopeView of every open editor.
+  ScopeHistory scopeHistory;
+
+  /// Number of open editors, the capture runs while it is not 0.
+  int32 openEditors = 0;
 };
 
 }  // namespace Radar
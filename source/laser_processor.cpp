@@ -18,7 +18,17 @@
  * - Polyphonic voice handling with up to 8 simultaneous notes.
  * - Real-time parameter updates for gain and oscillator frequencies.
  * - Support for MIDI NoteOn and NoteOff events.
+ * - Note expressions (tuning, volume, pan, brightness, pressure) and MPE
+ *   zones.
  * - Audio output with stereo channels.
+ * - Phase modulation, ring modulation and PolyBLEP hard sync between the
+ *   oscillators.
+ * - Optional output buses per voice group, rendered into without copies.
+ * - Wait-free, decimated output capture for the scope view.
+ * - Quality governor stealing voices when the DSP load nears the deadline.
+ * - Allocation free flight recorder of every block's inputs and state.
+ * - Chorus and tempo-synced stereo delay on the mix bus.
+ * - LFO/envelope/velocity modulation matrix evaluated at sub-block rate.
  *
  * Dependencies:
  * - Steinberg VST3 SDK
@@ -34,20 +44,54 @@
 #include "laser_processor.h"
 #include "laser_cids.h"
 
+#include <chrono>
+#include <cstring>
+
 #include "base/source/fstreamer.h"
 
+#include "pluginterfaces/vst/ivstnoteexpression.h"
 #include "pluginterfaces/vst/ivstparameterchanges.h"
 
 #include "public.sdk/source/vst/hosting/eventlist.h"
 #include "public.sdk/source/vst/vstaudioprocessoralgo.h"
 
 namespace Radar {
+
+static_assert(alignof(LaserProcessor) == kCacheLineSize,
+              "LaserProcessor hot state must start on its own cache line");
+static_assert(kNbrVoices == FlightBlockHeader::kMaxVoices,
+              "The flight recorder must hold every voice");
+static_assert(QualityGovernor::kMaxVoices[0] == kMaxPolyphony,
+              "Full quality plays the full polyphony");
+static_assert(kNbrVoices <= 32, "Voice bit masks are 32 bits wide");
+static_assert(sizeof(Voice) * kNbrVoices % kCacheLineSize == 0,
+              "The voice bank fills whole cache lines");
+static_assert(kNumRampParams <= FlightBlockHeader::kMaxRamps,
+              "The flight recorder must hold every parameter ramp");
+
+// Ramps read by the voice kernel, see ParamSmoothing::kRamp
+static constexpr int32 kGainRamp = rampIndex(kParamGainId);
+static constexpr int32 kOsc1Ramp = rampIndex(kOsc1);
+static constexpr int32 kOsc2Ramp = rampIndex(kOsc2);
+static constexpr int32 kPmDepthRamp = rampIndex(kPmDepth);
+static constexpr int32 kBendRamp = rampIndex(kPitchWheel);
+static_assert(kGainRamp >= 0 && kOsc1Ramp >= 0 && kOsc2Ramp >= 0 &&
+                  kPmDepthRamp >= 0 && kBendRamp >= 0,
+              "The voice kernel reads these parameters through their ramps");
+
 //-----------------------------------------------------------------------------
 // LaserProcessor
 //-----------------------------------------------------------------------------
 LaserProcessor::LaserProcessor() {
   //--- set the wanted controller for our processor
   setControllerClass(kLaserControllerUID);
+
+  // Start from the defaults of the table, through the same handlers as
+  // automation so the working copies agree with it
+  for (const ParamSpec& spec : kParamTable) {
+    applyParameter(spec.id, spec.defaultValue);
+  }
+  snapRamps();
 }
 
 //-----------------------------------------------------------------------------
@@ -69,8 +113,14 @@ tresult PLUGIN_API LaserProcessor::initialize(FUnknown* context) {
   // addAudioInput (STR16 ("Stereo In"), SpeakerArr::kStereo);
   addAudioOutput(STR16("Stereo Out"), SpeakerArr::kStereo);
 
+  // One inactive aux bus per voice group (in VoiceGroup order), for hosts
+  // that want the split layers on separate channels
+  addAudioOutput(STR16("Low Out"), SpeakerArr::kStereo, kAux, 0);
+  addAudioOutput(STR16("High Out"), SpeakerArr::kStereo, kAux, 0);
+
   /* If you don't need an event bus, you can remove the next line */
-  addEventInput(STR16("Event In"), 1);
+  // All 16 channels, MPE member channels carry one note each
+  addEventInput(STR16("Event In"), 16);
 
   return kResultOk;
 }
@@ -87,35 +137,322 @@ tresult PLUGIN_API LaserProcessor::terminate() {
 //-----------------------------------------------------------------------------
 tresult PLUGIN_API LaserProcessor::setActive(TBool state) {
   //--- called when the Plug-in is enable/disable (On/Off) -----
-  if (!state) {
+  if (state) {
+    // The one and only allocation of DSP memory for this instance
+    if (!mArena.allocate(mArenaSize)) {
+      return kOutOfMemory;
+    }
+    carveBuffers(mArena);
+    mArena.seal();
+
+    // Nothing sounded yet that a ramp would have to smooth
+    snapRamps();
+
+    // A bypassed instance starts silent instead of fading out
+    fBypassGain = fBypass > 0.5f ? 0.f : 1.f;
+    mWasPlaying = false;
+
+    mScope.setup(processSetup.sampleRate);
+    if (mScopeExchange) {
+      mScopeExchange->onActivate(processSetup);
+    }
+    mRecorder.start(processSetup);
+    mSession.start();
+  } else {
+    if (mScopeExchange) {
+      mScopeExchange->onDeactivate();
+    }
+
+    // The recorder worker reads the ring in the arena, the recorders have
+    // to leave it before the arena goes
+    mRecorder.stop();
+    mSession.stop();
+
     for (int v = 0; v < kNbrVoices; ++v) {
       voices[v] = Voice();  // Reset each voice
+      expressions[v] = VoiceExpression();
     }
+
+    mArena.release();
   }
 
   return AudioEffect::setActive(state);
 }
 
-static float getWaveSample(float phase, WaveParams type) {
+//-----------------------------------------------------------------------------
+tresult PLUGIN_API LaserProcessor::activateBus(MediaType type,
+                                               BusDirection dir, int32 index,
+                                               TBool state) {
+  tresult result = AudioEffect::activateBus(type, dir, index, state);
+
+  // Cache the routing of the voice groups, the host only calls this while
+  // not processing
+  if (result == kResultTrue && type == kAudio && dir == kOutput &&
+      index >= kFirstGroupBus && index < kFirstGroupBus + kNumVoiceGroups) {
+    mGroupBusActive[index - kFirstGroupBus] = state != 0;
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+tresult PLUGIN_API LaserProcessor::connect(IConnectionPoint* other) {
+  tresult result = AudioEffect::connect(other);
+  if (result == kResultTrue) {
+    mScopeExchange = std::make_unique<DataExchangeHandler>(
+        this, &ScopeCapture::configure);
+    mScopeExchange->onConnect(other, getHostContext());
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+tresult PLUGIN_API LaserProcessor::disconnect(IConnectionPoint* other) {
+  if (mScopeExchange) {
+    mScopeExchange->onDisconnect(other);
+    mScopeExchange.reset();
+  }
+  return AudioEffect::disconnect(other);
+}
+
+//-----------------------------------------------------------------------------
+tresult PLUGIN_API LaserProcessor::notify(IMessage* message) {
+  if (message &&
+      strcmp(message->getMessageID(), kScopeEnableMessageID) == 0) {
+    int64 enabled = 0;
+    if (message->getAttributes()->getInt(kScopeEnabledAttribute, enabled) ==
+        kResultTrue) {
+      mScopeEnabled.store(enabled != 0, std::memory_order_relaxed);
+    }
+    return kResultTrue;
+  }
+  return AudioEffect::notify(message);
+}
+
+//-----------------------------------------------------------------------------
+// Parameters
+//-----------------------------------------------------------------------------
+constexpr std::array<LaserProcessor::ParamHandler, kNumParams>
+LaserProcessor::makeParamHandlers() {
+  // Parameters with a working copy of their own
+  struct Binding {
+    ParamID id;
+    ParamHandler handler;
+  };
+  constexpr Binding kBindings[] = {
+      {kWaveForm, &LaserProcessor::setWaveForm},
+      {kOscCoupling, &LaserProcessor::setField<&LaserProcessor::fOscCoupling>},
+      {kOscRatio, &LaserProcessor::setField<&LaserProcessor::fOscRatio>},
+      {kDelayMix, &LaserProcessor::setField<&LaserProcessor::fDelayMix>},
+      {kDelayTime, &LaserProcessor::setField<&LaserProcessor::fDelayTime>},
+      {kDelayFeedback,
+       &LaserProcessor::setField<&LaserProcessor::fDelayFeedback>},
+      {kDelaySync, &LaserProcessor::setField<&LaserProcessor::fDelaySync>},
+      {kChorusMix, &LaserProcessor::setField<&LaserProcessor::fChorusMix>},
+      {kChorusRate, &LaserProcessor::setField<&LaserProcessor::fChorusRate>},
+      {kChorusDepth, &LaserProcessor::setField<&LaserProcessor::fChorusDepth>},
+      {kMpeZone, &LaserProcessor::setField<&LaserProcessor::fMpeZone>},
+      {kMpeMemberChannels,
+       &LaserProcessor::setField<&LaserProcessor::fMpeMemberChannels>},
+      {kSplitKey, &LaserProcessor::setField<&LaserProcessor::fSplitKey>},
+      {kGovernorEnabled,
+       &LaserProcessor::setField<&LaserProcessor::fGovernorEnabled>},
+      {kBypass, &LaserProcessor::setField<&LaserProcessor::fBypass>},
+      {kSustainPedal, &LaserProcessor::setSustain},
+      {kSostenutoPedal, &LaserProcessor::setSostenuto},
+      {kFlightDump, &LaserProcessor::setFlightDump},
+      {kSessionCapture, &LaserProcessor::setSessionCapture}};
+
+  std::array<ParamHandler, kNumParams> handlers = {};
+  for (const Binding& binding : kBindings) {
+    handlers[paramIndex(binding.id)] = binding.handler;
+  }
+
+  // Ramped parameters and the modulation matrix share one handler each
+  for (int32 i = 0; i < kNumParams; i++) {
+    if (kParamTable[i].smoothing == ParamSmoothing::kRamp) {
+      handlers[i] = &LaserProcessor::setRamped;
+    } else if (ModMatrix::isModulationParameter(kParamTable[i].id)) {
+      handlers[i] = &LaserProcessor::setModulation;
+    }
+  }
+  return handlers;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::applyParameter(ParamID id, ParamValue value) {
+  static constexpr std::array<ParamHandler, kNumParams> kHandlers =
+      makeParamHandlers();
+  static_assert(
+      [] {
+        for (int32 i = 0; i < kNumParams; i++) {
+          const bool readOnly =
+              (kParamTable[i].flags & ParameterInfo::kIsReadOnly) != 0;
+          if ((kHandlers[i] == nullptr) != readOnly) {
+            return false;
+          }
+        }
+        return true;
+      }(),
+      "Every parameter the host writes needs a handler");
+
+  const int32 index = paramIndex(id);
+  if (index < 0 || kHandlers[index] == nullptr) {
+    return;
+  }
+  mParamValues[index] = (float) value;
+  (this->*kHandlers[index])(index, value);
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::setRamped(int32 index, ParamValue value) {
+  mRamps[rampIndex(kParamTable[index].id)].target = (float) value;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::setWaveForm(int32 index, ParamValue value) {
+  kWaveFormType = toStep(kParamTable[index], value);
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::setModulation(int32 index, ParamValue value) {
+  mModMatrix.setParameter(kParamTable[index].id, (float) value);
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::setFlightDump(int32 /*index*/, ParamValue value) {
+  // Dump once per switch on
+  bool on = value > 0.5;
+  if (on && !mFlightDumpOn) {
+    mRecorder.requestDump(kFlightTriggerUser);
+  }
+  mFlightDumpOn = on;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::setSessionCapture(int32 index, ParamValue value) {
+  // Picked up by process() once the block's changes are applied
+  mSessionCaptureOn = toStep(kParamTable[index], value) != 0;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::setSustain(int32 index, ParamValue value) {
+  const bool wasOn = mSustainOn;
+  mSustainOn = toStep(kParamTable[index], value) != 0;
+  if (wasOn && !mSustainOn) {
+    releasePedalVoices();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::setSostenuto(int32 index, ParamValue value) {
+  const bool wasOn = mSostenutoOn;
+  mSostenutoOn = toStep(kParamTable[index], value) != 0;
+  if (!wasOn && mSostenutoOn) {
+    // Only the notes down at this moment are latched, not the ones a pedal
+    // already holds or the ones played later
+    mSostenutoVoices = 0;
+    for (int32 v = 0; v < kNbrVoices; ++v) {
+      if (voices[v].active && voices[v].envelopePhase == kAttackPhase &&
+          !(mPedalHeldVoices & (1u << v))) {
+        mSostenutoVoices |= 1u << v;
+      }
+    }
+  } else if (wasOn && !mSostenutoOn) {
+    mSostenutoVoices = 0;
+    releasePedalVoices();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::releasePedalVoices() {
+  if (mSustainOn) {
+    return;
+  }
+  const uint32 released = mPedalHeldVoices & ~mSostenutoVoices;
+  for (int32 v = 0; v < kNbrVoices; ++v) {
+    if ((released & (1u << v)) && voices[v].active &&
+        voices[v].envelopePhase != kStealPhase) {
+      voices[v].envelopePhase = kReleasePhase;
+    }
+  }
+  mPedalHeldVoices &= ~released;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::advanceRamps() {
+  for (ParamRamp& ramp : mRamps) {
+    ramp.advance(fRampCoefficient);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::snapRamps() {
+  for (ParamRamp& ramp : mRamps) {
+    ramp.snap();
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Scales of a Phase read as a signed number: a cycle in radians and [-1..1)
+static const float kPhaseToRadians = (float) (2. * M_PI / kPhaseCycle);
+static const float kPhaseToUnit = 1.f / 2147483648.f;
+
+//-----------------------------------------------------------------------------
+static float getWaveSample(Phase phase, WaveParams type) {
   switch (type) {
     case kSine:
     default:
-      // Sine wave
-      return sinf(phase);
+      // Sine wave: the signed phase covers [-π..π), exact around zero
+      return sinf((float) (int32) phase * kPhaseToRadians);
 
     case kSaw:
-      // Saw wave: goes from -1.0 to +1.0 as phase goes 0..2π
-      // (phase / 2π) => range [0..1], scale to [0..2], shift => [-1..+1]
-      return 2.0f * (phase / (2.0f * (float)M_PI)) - 1.0f;
+      // Saw wave: goes from -1.0 to +1.0 over one cycle
+      return (float) (int32) (phase - 0x80000000u) * kPhaseToUnit;
 
     case kSquare:
-      // Square wave: +1 if sin(phase) ≥ 0; -1 if sin(phase) < 0
-      return (sinf(phase) >= 0.0f) ? 1.0f : -1.0f;
+      // Square wave: +1 for the first half of the cycle, -1 for the second
+      return (phase < 0x80000000u) ? 1.0f : -1.0f;
   }
 }
 
+//-----------------------------------------------------------------------------
+// Frequency ratio of a normalized pitch wheel position. Hosts center the
+// wheel on 8192/16383, which is taken as no bend so held notes keep their
+// exact table increment
+static float getBendRatio(float wheel) {
+  const float bend = 2.f * wheel - 1.f;
+  if (fabsf(bend) < 1.f / 8192.f) {
+    return 1.f;
+  }
+  return exp2f(bend * kPitchBendRange / 12.f);
+}
+
 //-----------------------------------------------------------------------------
 tresult PLUGIN_API LaserProcessor::process(ProcessData& data) {
+  const auto processStart = std::chrono::steady_clock::now();
+
+  // Snapshot the state this block starts from before anything changes it
+  FlightBlockHeader* flight =
+      mArena.isAllocated() ? mRecorder.beginBlock() : nullptr;
+  if (flight) {
+    captureFlightState(*flight);
+    flight->numSamples = data.numSamples;
+    if (data.processContext) {
+      flight->contextState = data.processContext->state;
+      flight->projectTimeSamples = data.processContext->projectTimeSamples;
+      flight->tempo = (data.processContext->state & ProcessContext::kTempoValid)
+                          ? data.processContext->tempo
+                          : 0.;
+    } else {
+      flight->contextState = 0;
+      flight->projectTimeSamples = 0;
+      flight->tempo = 0.;
+    }
+  }
+
+  // The capture sees the inputs before anything consumes them
+  mSession.captureBlock(data);
+
   //--- First : Read inputs parameter changes-----------
   if (data.inputParameterChanges) {
     // for each parameter defined by its ID
@@ -134,173 +471,888 @@ tresult PLUGIN_API LaserProcessor::process(ProcessData& data) {
 
           if (paramQueue->getPoint(numPoints - 1, sampleOffset, value) ==
               kResultTrue) {
+            mRecorder.addParamChange(paramQueue->getParameterId(),
+                                     sampleOffset, value);
 
-            switch (paramQueue->getParameterId()) {
-              case WaveParams::kWaveForm:
-                // value is in [0..1] but we have 3 discrete waveforms:
-                // convert param float 0..1 => int 0..2
-                kWaveFormType = static_cast<int>(value * 2.999999f);
-                break;
-
-              case GainParams::kParamGainId:
-                mGain = (float) value;
-                break;
-
-              case FrequencyParams::kOsc1:
-                fOsc1 = (float) value;
-                break;
-
-              case FrequencyParams::kOsc2:
-                fOsc2 = (float) value;
-                break;
-            }
+            applyParameter(paramQueue->getParameterId(), value);
           }
         }
       }
     }
   }
 
+  // A capture starts with the next block, from the values set by now
+  if (mSessionCaptureOn != mSession.isCapturing()) {
+    if (mSessionCaptureOn) {
+      beginSessionCapture();
+    } else {
+      mSession.end();
+    }
+  }
+
   //---Second: Read input events-------------
-  // get the list of all event changes
+  // The whole list is read in batches, sorted and rid of notes that would
+  // never sound before any voice is allocated
   IEventList* events = data.inputEvents;
 
   if (events != NULL) {
     int32 numEvent = events->getEventCount();
 
-    for (int32 i = 0; i < numEvent; i++) {
-      Event event;
-
-      if (events->getEvent(i, event) == kResultOk) {
-
-        switch (event.type) {
-          case Event::kNoteOnEvent: {
-            // Find a free voice or steal one
-            for (int v = 0; v < kNbrVoices; ++v) {
-              if (!voices[v].active) {  // Find an inactive voice
-                voices[v].frequency =
-                  kFrequencyA4 * powf(2.f, (event.noteOn.pitch - kMIDINoteA4)
-                                            / 12.f);
-
-                voices[v].deltaAngle = PI2 * voices[v].frequency
-                                      / data.processContext->sampleRate;
-
-                voices[v].phase1 = 0.f;
-                voices[v].phase2 = 0.f;
-                voices[v].volume = 0.3f;
-                voices[v].gainReduction = event.noteOn.velocity;
-
-                // Reset envelope to attack phase
-                voices[v].envelopeLevel = 0.f;
-                voices[v].envelopePhase = 0.f;  // Attack phase
-                voices[v].active = true;
-                break;
-              }
-            }
-            break;
-          }
-          case Event::kNoteOffEvent: {
-            // Turn off voices matching the note
-            for (int v = 0; v < kNbrVoices; ++v) {
-              if (fabsf(voices[v].frequency -
-                        kFrequencyA4 * powf(2.f, (float)(event.noteOff.pitch -
-                                                          kMIDINoteA4) /
-                                                      12.f)) <= 0.001f) {
-                // Trigger release phase
-                voices[v].envelopePhase = 1.f;  // Start release
-              }
-            }
-            break;
-          }
-        }
+    for (int32 next = 0; next < numEvent;) {
+      next = mEvents.read(*events, next);
+      for (int32 i = 0; i < mEvents.getNumRead(); i++) {
+        mRecorder.addEvent(mEvents.getRead(i));
+      }
+
+      mEvents.prepare(getMpeLayout() != kMpeOff, !mSustainOn);
+      for (int32 i = 0; i < mEvents.size(); i++) {
+        handleEvent(mEvents[i]);
       }
     }
   }
 
+  // Stopping the transport silences hanging notes without cutting the
+  // effect tails: every voice takes the short fade of a stolen voice
+  if (data.processContext) {
+    bool playing = (data.processContext->state & ProcessContext::kPlaying) != 0;
+    if (mWasPlaying && !playing) {
+      releaseAllVoices();
+    }
+    mWasPlaying = playing;
+  }
+
   //--- Here, you have to implement your processing
 
   // now we will produce the output
   // mark our outputs has not silent
   data.outputs[0].silenceFlags = 0;
 
-  float gain = mGain - mGainReduction;
+  Sample32* outL = data.outputs[0].channelBuffers32[0];
+  Sample32* outR = data.outputs[0].channelBuffers32[1];
 
-  if (gain < 0.f) {  // gain should always positive or zero
-    gain = 0.f;
+  // Voice groups whose bus is active render straight into the host buffers
+  // of that bus. Inactive buses are only flagged silent: the host does not
+  // read them, so they are not even cleared
+  uint32 groupBuses = 0;
+  for (int32 group = 0; group < kNumVoiceGroups; group++) {
+    int32 bus = kFirstGroupBus + group;
+    if (bus >= data.numOutputs) {
+      continue;
+    }
+    if (mGroupBusActive[group] && data.outputs[bus].numChannels >= 2) {
+      groupBuses |= 1 << group;
+    } else {
+      data.outputs[bus].silenceFlags = 0x3;
+    }
+  }
+
+  // Without the arena (process() before setActive(true)) there are no
+  // buffers to render into, and allocating here is not an option
+  if (!mArena.isAllocated()) {
+    clearOutputs(data, groupBuses);
+    return kResultOk;
+  }
+
+  if (flight) {
+    flight->groupBuses = groupBuses;
+  }
+
+  // The governor may have lowered the polyphony after the last block
+  limitVoices(mGovernor.getMaxVoices());
+
+  // Effects follow their parameters and the host tempo once per block
+  double tempo = 120.;
+  if (data.processContext &&
+      (data.processContext->state & ProcessContext::kTempoValid)) {
+    tempo = data.processContext->tempo;
+  }
+  mChorus.setParameters(fChorusMix, fChorusRate, fChorusDepth);
+  mDelay.setParameters(fDelayMix, fDelayTime, fDelayFeedback,
+                       fDelaySync > 0.5f, tempo);
+
+  // Oscillator 2 ratio from 0.5 to 8, with 2 in the middle
+  fOsc2Ratio = 0.5 * pow(16., (double) fOscRatio);
+
+  // Once the bypass faded the output out nothing is rendered at all. The
+  // voices keep their state and resume where they were when it ends, the
+  // LFOs keep running.
+  uint32 soundingGroups = 0;
+  if (fBypass > 0.5f && fBypassGain <= 0.f) {
+    clearOutputs(data, groupBuses);
+    mModMatrix.advance(data.numSamples, processSetup.sampleRate);
+  } else {
+    soundingGroups = renderBlock(data, groupBuses);
+    applyBypassFade(data, groupBuses);
+  }
+
+  // Feed the scope while an editor is open, drop the partial block once
+  // the last one closed
+  if (mScopeExchange) {
+    if (mScopeEnabled.load(std::memory_order_relaxed)) {
+      mScope.process(outL, outR, data.numSamples, *mScopeExchange);
+    } else if (mScope.isCapturing()) {
+      mScope.stop(*mScopeExchange);
+    }
   }
 
+  // Group buses are dry, they are silent exactly when no voice of the group
+  // was sounding
+  for (int32 group = 0; group < kNumVoiceGroups; group++) {
+    if (groupBuses & (1 << group)) {
+      data.outputs[kFirstGroupBus + group].silenceFlags =
+          (soundingGroups & (1 << group)) ? 0 : 0x3;
+    }
+  }
+
+  // So is the main output when no voice played into the mix and no effect
+  // can still be ringing
+  const uint32 mixGroups = ~groupBuses & ((1u << kNumVoiceGroups) - 1);
+  if ((soundingGroups & mixGroups) == 0 && mChorus.isBypassed() &&
+      mDelay.isBypassed()) {
+    data.outputs[0].silenceFlags = 0x3;
+  }
+
+  // Measure this block against its deadline, a new quality level applies
+  // from the next block on. Offline rendering has no deadline, whether the
+  // setup or only this block says so.
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - processStart;
+  const bool offline = processSetup.processMode == kOffline ||
+                       data.processMode == kOffline;
+  bool report = false;
+  if (mQualityForced) {
+    // Replay holds the recorded level
+  } else if (fGovernorEnabled > 0.5f && !offline) {
+    report = mGovernor.update(elapsed.count(), data.numSamples);
+  } else if (mGovernor.getLevel() != 0 || mGovernor.getLoad() != 0.f) {
+    mGovernor.reset();
+    report = true;
+  }
+
+  // Diagnostics for the controller, as read-only output parameters
+  if (report && data.outputParameterChanges) {
+    int32 index = 0;
+    if (IParamValueQueue* queue = data.outputParameterChanges->addParameterData(
+            GovernorParams::kGovernorLevel, index)) {
+      queue->addPoint(0,
+                      (ParamValue) mGovernor.getLevel() /
+                          (QualityGovernor::kNumLevels - 1),
+                      index);
+    }
+    if (IParamValueQueue* queue = data.outputParameterChanges->addParameterData(
+            GovernorParams::kGovernorLoad, index)) {
+      queue->addPoint(0, std::min(1.f, mGovernor.getLoad() * 0.5f), index);
+    }
+  }
+
+  if (flight) {
+    float load = 0.f;
+    if (data.numSamples > 0) {
+      load = (float) (elapsed.count() * processSetup.sampleRate /
+                      data.numSamples);
+    }
+    mRecorder.endBlock(outL, outR, data.numSamples, load);
+  }
+
+  return kResultOk;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::handleEvent(const Event& event) {
+  switch (event.type) {
+    case Event::kNoteOnEvent: {
+      if (!acceptsChannel(event.noteOn.channel)) {
+        break;
+      }
+
+      // Find a free voice or steal one. The polyphony allowed by the
+      // governor is kept by fading out the quietest voices, which finish
+      // their fade while the new note takes one of the spare voices
+      limitVoices(mGovernor.getMaxVoices() - 1);
+      const int v = findFreeVoice();
+
+      // Increment from the tuning table, NoteOn tuning is in cents
+      voices[v].phaseIncrement = mTuning.getIncrement(event.noteOn.pitch);
+      if (event.noteOn.tuning != 0.f) {
+        voices[v].phaseIncrement = TuningTable::scaleIncrement(
+            voices[v].phaseIncrement, exp2(event.noteOn.tuning / 1200.));
+      }
+
+      voices[v].phase1 = 0;
+      voices[v].phase2 = 0;
+      voices[v].volume = 0.3f;
+      voices[v].gainReduction = event.noteOn.velocity;
+
+      // Reset envelope to attack phase
+      voices[v].envelopeLevel = 0.f;
+      voices[v].envelopePhase = kAttackPhase;
+      voices[v].active = true;
+      voices[v].group =
+          (event.noteOn.pitch < (int16) (fSplitKey * 127.f + 0.5f))
+              ? kVoiceGroupLow
+              : kVoiceGroupHigh;
+
+      // Fresh expression lane, no ramp from the previous note
+      expressions[v] = VoiceExpression();
+      expressions[v].noteId = event.noteOn.noteId;
+      expressions[v].channel = event.noteOn.channel;
+      expressions[v].pitch = event.noteOn.pitch;
+
+      // A new note is not held by the pedals of the one it replaces
+      mPedalHeldVoices &= ~(1u << v);
+      mSostenutoVoices &= ~(1u << v);
+      break;
+    }
+    case Event::kNoteOffEvent: {
+      // Turn off voices matching the note: by host note ID when there is
+      // one, by channel and pitch in MPE mode, by pitch otherwise
+      const bool matchChannel = getMpeLayout() != kMpeOff;
+      for (int v = 0; v < kNbrVoices; ++v) {
+        bool matches;
+        if (event.noteOff.noteId != -1) {
+          matches = expressions[v].noteId == event.noteOff.noteId;
+        } else {
+          matches = expressions[v].pitch == event.noteOff.pitch &&
+                    (!matchChannel ||
+                     expressions[v].channel == event.noteOff.channel);
+        }
+
+        // Trigger release phase, a stolen voice keeps its fast fade. While
+        // a pedal holds the voice it only remembers that its note ended
+        if (!matches || voices[v].envelopePhase == kStealPhase) {
+          continue;
+        }
+        if (mSustainOn || (mSostenutoVoices & (1u << v))) {
+          mPedalHeldVoices |= 1u << v;
+        } else {
+          voices[v].envelopePhase = kReleasePhase;
+        }
+      }
+      break;
+    }
+    case Event::kNoteExpressionValueEvent: {
+      // Only the lane of the addressed note is updated, the voice kernel
+      // picks the new targets up at its next sub-block
+      const NoteExpressionValueEvent& expression = event.noteExpressionValue;
+      for (int v = 0; v < kNbrVoices; ++v) {
+        if (voices[v].active && expressions[v].noteId == expression.noteId) {
+          applyNoteExpression(expressions[v], expression.typeId,
+                              (float) expression.value);
+        }
+      }
+      break;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+uint32 LaserProcessor::renderBlock(ProcessData& data, uint32 groupBuses) {
   Sample32* outL = data.outputs[0].channelBuffers32[0];
   Sample32* outR = data.outputs[0].channelBuffers32[1];
 
-  for (int32 i = 0; i < data.numSamples; i++) {
-    float sampleL = 0.f;
-    float sampleR = 0.f;
+  // Render in chunks no larger than the buffers carved in setActive()
+  uint32 soundingGroups = 0;
+  for (int32 offset = 0; offset < data.numSamples; offset += mMixL.size) {
+    int32 numSamples = std::min(mMixL.size, data.numSamples - offset);
+
+    RenderTargets targets;
+    for (int32 group = 0; group < kNumVoiceGroups; group++) {
+      if (groupBuses & (1 << group)) {
+        AudioBusBuffers& output = data.outputs[kFirstGroupBus + group];
+        targets.left[group] = output.channelBuffers32[0] + offset;
+        targets.right[group] = output.channelBuffers32[1] + offset;
+      } else {
+        targets.left[group] = mMixL.data;
+        targets.right[group] = mMixR.data;
+      }
+    }
 
-    // Mix all active voices
-    for (int v = 0; v < kNbrVoices; ++v) {
-      if (voices[v].active) {
-        // Handle Envelope Attack/ Release
-        if (voices[v].envelopePhase < 1.f) {  // Attack phase
-          voices[v].envelopeLevel +=
-              1.f / (Voice::attackTime * data.processContext->sampleRate);
-          if (voices[v].envelopeLevel >= 1.f) {
-            voices[v].envelopeLevel = 1.f;
-          }
-        } else {  // Release phase
-          voices[v].envelopeLevel *=
-            exp(-5.f /
-                (Voice::releaseTime * data.processContext->sampleRate));
-
-          // Continue processing the tail instead of cutting off immediately
-          if (voices[v].envelopeLevel <= 0.001f) {  // Close to zero threshold
-            voices[v].envelopeLevel = 0.f;
-            voices[v].active = false;
-          }
+    // Cleared even when every group has its own bus: the effects tails and
+    // the main output still come from it
+    memset(mMixL.data, 0, sizeof(Sample32) * numSamples);
+    memset(mMixR.data, 0, sizeof(Sample32) * numSamples);
+    soundingGroups |= renderVoices(targets, numSamples);
+
+    // Post-mix effects, skipped entirely while their mix is 0
+    if (!mChorus.isBypassed()) {
+      mChorus.process(mMixL.data, mMixR.data, numSamples);
+    }
+    if (!mDelay.isBypassed()) {
+      mDelay.process(mMixL.data, mMixR.data, numSamples);
+    }
+
+    // DC offset removal and clipping protection
+    for (int32 i = 0; i < numSamples; i++) {
+      outL[offset + i] = std::min(1.f, std::max(-1.f, mMixL[i]));
+      outR[offset + i] = std::min(1.f, std::max(-1.f, mMixR[i]));
+    }
+  }
+
+  return soundingGroups;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::clearOutputs(ProcessData& data, uint32 groupBuses) {
+  AudioBusBuffers& main = data.outputs[0];
+  memset(main.channelBuffers32[0], 0, sizeof(Sample32) * data.numSamples);
+  memset(main.channelBuffers32[1], 0, sizeof(Sample32) * data.numSamples);
+  main.silenceFlags = 0x3;
+  for (int32 group = 0; group < kNumVoiceGroups; group++) {
+    if (groupBuses & (1 << group)) {
+      AudioBusBuffers& output = data.outputs[kFirstGroupBus + group];
+      memset(output.channelBuffers32[0], 0,
+             sizeof(Sample32) * data.numSamples);
+      memset(output.channelBuffers32[1], 0,
+             sizeof(Sample32) * data.numSamples);
+      output.silenceFlags = 0x3;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Ramps a stereo buffer from `gain` towards `target`, returns the end gain
+static float fadeStereo(Sample32* left, Sample32* right, int32 numSamples,
+                        float gain, float target, float step) {
+  for (int32 i = 0; i < numSamples; i++) {
+    gain = (gain < target) ? std::min(target, gain + step)
+                           : std::max(target, gain - step);
+    left[i] *= gain;
+    right[i] *= gain;
+  }
+  return gain;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::applyBypassFade(ProcessData& data, uint32 groupBuses) {
+  const float target = (fBypass > 0.5f) ? 0.f : 1.f;
+  if (fBypassGain == 1.f && target == 1.f) {
+    return;
+  }
+
+  // Every bus follows the same ramp
+  const float start = fBypassGain;
+  fBypassGain = fadeStereo(data.outputs[0].channelBuffers32[0],
+                           data.outputs[0].channelBuffers32[1],
+                           data.numSamples, start, target, fBypassStep);
+  for (int32 group = 0; group < kNumVoiceGroups; group++) {
+    if (groupBuses & (1 << group)) {
+      AudioBusBuffers& output = data.outputs[kFirstGroupBus + group];
+      fadeStereo(output.channelBuffers32[0], output.channelBuffers32[1],
+                 data.numSamples, start, target, fBypassStep);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::releaseAllVoices() {
+  for (int32 v = 0; v < kNbrVoices; ++v) {
+    if (voices[v].active) {
+      voices[v].envelopePhase = kStealPhase;
+    }
+  }
+  mPedalHeldVoices = 0;
+  mSostenutoVoices = 0;
+}
+
+//-----------------------------------------------------------------------------
+uint32 LaserProcessor::renderVoices(const RenderTargets& targets,
+                                    int32 numSamples) {
+  // Group buses start silent, the caller already cleared the mix bus
+  for (int32 group = 0; group < kNumVoiceGroups; group++) {
+    if (targets.left[group] != mMixL.data) {
+      memset(targets.left[group], 0, sizeof(Sample32) * numSamples);
+      memset(targets.right[group], 0, sizeof(Sample32) * numSamples);
+    }
+  }
+
+  // Every voice that renders in this chunk is already active here
+  uint32 soundingGroups = 0;
+  for (int v = 0; v < kNbrVoices; ++v) {
+    if (voices[v].active) {
+      soundingGroups |= 1 << voices[v].group;
+    }
+  }
+
+  // The LFOs keep running even without a voice to modulate
+  mModMatrix.render(numSamples, processSetup.sampleRate);
+  if (soundingGroups == 0) {
+    // Nobody would hear the ramps either
+    snapRamps();
+    return 0;
+  }
+
+  // One kernel per routing combination and coupling, so destinations nobody
+  // modulates and couplings not in use add nothing to the per-sample loop
+  using Routings = std::make_integer_sequence<uint32, ModMatrix::kNumRoutings>;
+  static constexpr std::array<Kernel, ModMatrix::kNumRoutings>
+      kKernels[kNumOscCouplings] = {makeKernels<kCouplingMix>(Routings()),
+                                    makeKernels<kCouplingPm>(Routings()),
+                                    makeKernels<kCouplingRing>(Routings()),
+                                    makeKernels<kCouplingSync>(Routings())};
+  const Kernel kernel =
+      kKernels[getOscCoupling()][mModMatrix.getRouting()];
+
+  int32 point = 0;
+  for (int32 offset = 0; offset < numSamples;
+       offset += ModMatrix::kSubBlockSize) {
+    int32 subBlockSize =
+        std::min(ModMatrix::kSubBlockSize, numSamples - offset);
+    advanceRamps();
+    fBendRatio = getBendRatio(mRamps[kBendRamp].value);
+    (this->*kernel)(targets, offset, subBlockSize, point++);
+  }
+
+  return soundingGroups;
+}
+
+//-----------------------------------------------------------------------------
+// Maps a bipolar modulation value onto a level multiplier
+static inline float modulationScale(float modulation) {
+  return std::max(0.f, 1.f + modulation);
+}
+
+//-----------------------------------------------------------------------------
+template <uint32 kRouting, int32 kCoupling>
+void LaserProcessor::renderSubBlock(const RenderTargets& targets,
+                                    int32 offset, int32 numSamples,
+                                    int32 point) {
+  const WaveParams waveType = (WaveParams) (int) kWaveFormType;
+  const float rampScale = 1.f / (float) numSamples;
+
+  // Oscillator 1 output to Oscillator 2 phase offset
+  const float pmScale =
+      mRamps[kPmDepthRamp].value * (float) (kMaxPmCycles * kPhaseCycle);
+  const float osc1 = mRamps[kOsc1Ramp].value;
+  const float osc2 = mRamps[kOsc2Ramp].value;
+  const float masterGain = mRamps[kGainRamp].value;
+
+  // Mix all active voices
+  for (int v = 0; v < kNbrVoices; ++v) {
+    Voice& voice = voices[v];
+    if (!voice.active) {
+      continue;
+    }
+
+    VoiceExpression& expression = expressions[v];
+    Sample32* mixL = targets.left[voice.group] + offset;
+    Sample32* mixR = targets.right[voice.group] + offset;
+
+    // Expression tuning and pitch modulation retune the increment once per
+    // sub-block, an untouched voice keeps its exact table increment
+    float pitchRatio = expression.tuning * fBendRatio;
+    float level1 = osc1;
+    float level2 = osc2;
+    float level1Step = 0.f;
+    float level2Step = 0.f;
+    float gain = masterGain * (1.f - voice.gainReduction);  // Scale gain
+    float gainStep = 0.f;
+
+    // Per-voice sources are sampled once per sub-block; `gainReduction`
+    // holds the NoteOn velocity
+    const float envelope = voice.envelopeLevel;
+    const float velocity = voice.gainReduction;
+
+    // Stolen voices fade out much faster than a normal release
+    const float releaseFactor =
+        (voice.envelopePhase == kStealPhase) ? fStealFactor : fReleaseFactor;
+
+    if constexpr ((kRouting & ModMatrix::kRoutePitch) != 0) {
+      float octaves = mModMatrix.voiceValue(kModDestPitch, point, envelope,
+                                            velocity);
+      pitchRatio *= exp2f(octaves * ModMatrix::kPitchRange);
+    }
+    Phase increment = voice.phaseIncrement;
+    if (pitchRatio != 1.f) {
+      increment = TuningTable::scaleIncrement(increment, pitchRatio);
+    }
+    const Phase increment2 =
+        TuningTable::scaleIncrement(increment, fOsc2Ratio);
+
+    // Second half of a sync step that fell just before this sub-block
+    float syncBlep = expression.syncBlep;
+
+    // Levels and gain ramp from this sub-block boundary to the next
+    if constexpr ((kRouting & ModMatrix::kRouteLevels) != 0) {
+      level1 = osc1 * modulationScale(mModMatrix.voiceValue(
+                          kModDestOsc1Level, point, envelope, velocity));
+      level2 = osc2 * modulationScale(mModMatrix.voiceValue(
+                          kModDestOsc2Level, point, envelope, velocity));
+      float end1 = osc1 * modulationScale(mModMatrix.voiceValue(
+                              kModDestOsc1Level, point + 1, envelope,
+                              velocity));
+      float end2 = osc2 * modulationScale(mModMatrix.voiceValue(
+                              kModDestOsc2Level, point + 1, envelope,
+                              velocity));
+      level1Step = (end1 - level1) * rampScale;
+      level2Step = (end2 - level2) * rampScale;
+    }
+
+    // Brightness tilts the balance towards the upper oscillator
+    level2 *= expression.brightness;
+    level2Step *= expression.brightness;
+
+    // Volume and pan expressions ramp from the gains applied last
+    float gainL = expression.gainL;
+    float gainR = expression.gainR;
+    float level = expression.volume * expression.pressure;
+    float targetL = level * std::min(1.f, 2.f - 2.f * expression.pan);
+    float targetR = level * std::min(1.f, 2.f * expression.pan);
+    float gainLStep = (targetL - gainL) * rampScale;
+    float gainRStep = (targetR - gainR) * rampScale;
+    expression.gainL = targetL;
+    expression.gainR = targetR;
+
+    if constexpr ((kRouting & ModMatrix::kRouteGain) != 0) {
+      float baseGain = gain;
+      gain = baseGain * modulationScale(mModMatrix.voiceValue(
+                            kModDestGain, point, envelope, velocity));
+      float end = baseGain * modulationScale(mModMatrix.voiceValue(
+                                 kModDestGain, point + 1, envelope, velocity));
+      gainStep = (end - gain) * rampScale;
+    }
+
+    for (int32 i = 0; i < numSamples; i++) {
+      // Handle Envelope Attack/ Release
+      if (voice.envelopePhase == kAttackPhase) {
+        voice.envelopeLevel += fAttackStep;
+        if (voice.envelopeLevel >= 1.f) {
+          voice.envelopeLevel = 1.f;
+        }
+      } else {  // Release phase
+        voice.envelopeLevel *= releaseFactor;
+
+        // Continue processing the tail instead of cutting off immediately
+        if (voice.envelopeLevel <= 0.001f) {  // Close to zero threshold
+          voice.envelopeLevel = 0.f;
+          voice.active = false;
         }
+      }
+
+      const float wave1 = getWaveSample(voice.phase1, waveType);
+      float wave2;
+      if constexpr (kCoupling == kCouplingPm) {
+        Phase modulation = (Phase) (int64) (wave1 * pmScale);
+        wave2 = getWaveSample(voice.phase2 + modulation, waveType);
+      } else if constexpr (kCoupling == kCouplingRing) {
+        wave2 = wave1 * getWaveSample(voice.phase2, waveType);
+      } else {
+        wave2 = getWaveSample(voice.phase2, waveType);
+      }
 
-        // Apply Gain and Envelope to the Oscillators
-        float gain = mGain * (1.f - voices[v].gainReduction);  // Scale gain
-        float osc1 = fOsc1 * getWaveSample(voices[v].phase1,
-                                           (WaveParams)kWaveFormType);
-        float osc2 = fOsc2 * getWaveSample(voices[v].phase2,
-                                           (WaveParams)kWaveFormType);
+      Phase nextPhase1 = voice.phase1 + increment;
+      Phase nextPhase2 = voice.phase2 + increment2;
+      if constexpr (kCoupling == kCouplingSync) {
+        wave2 += syncBlep;
+        syncBlep = 0.f;
+
+        // Oscillator 1 wraps before the next sample and restarts
+        // Oscillator 2 there. The step is spread over this sample and the
+        // next one with a PolyBLEP residual.
+        if (nextPhase1 < voice.phase1) {
+          const float after = (float) nextPhase1 / (float) increment;
+          const float before = 1.f - after;
+          const Phase wrapPhase2 =
+              voice.phase2 + (Phase) (before * (float) increment2);
+          const float halfStep = 0.5f * (getWaveSample(0, waveType) -
+                                         getWaveSample(wrapPhase2, waveType));
+          wave2 += halfStep * after * after;
+          syncBlep = -halfStep * before * before;
+          nextPhase2 = (Phase) (after * (float) increment2);
+        }
+      }
 
-        // Combine oscillators and apply envelope and gain
-        float voiceSample = (osc1 + osc2) *
-                            voices[v].volume * voices[v].envelopeLevel * gain;
+      // Apply Gain and Envelope to the Oscillators
+      float out1 = level1 * wave1;
+      float out2 = level2 * wave2;
 
-        // Smooth exponential scaling
-        voiceSample *= powf(voices[v].envelopeLevel, 2.f);
+      // Combine oscillators and apply envelope and gain
+      float voiceSample =
+          (out1 + out2) * voice.volume * voice.envelopeLevel * gain;
 
-        // Mix into stereo output
-        sampleL += voiceSample;  // Left channel
-        sampleR += voiceSample;  // Right channel
+      // Smooth exponential scaling
+      voiceSample *= voice.envelopeLevel * voice.envelopeLevel;
 
-        voices[v].phase1 += voices[v].deltaAngle;
-        voices[v].phase2 += voices[v].deltaAngle * 2.f;
+      // Mix into stereo output
+      mixL[i] += voiceSample * gainL;  // Left channel
+      mixR[i] += voiceSample * gainR;  // Right channel
+      gainL += gainLStep;
+      gainR += gainRStep;
 
-        // Smooth phase wrapping for continuity
-        if (voices[v].phase1 > PI2) voices[v].phase1 -= PI2;
-        if (voices[v].phase2 > PI2) voices[v].phase2 -= PI2;
+      // Phases wrap by unsigned overflow
+      voice.phase1 = nextPhase1;
+      voice.phase2 = nextPhase2;
+
+      if constexpr ((kRouting & ModMatrix::kRouteLevels) != 0) {
+        level1 += level1Step;
+        level2 += level2Step;
+      }
+      if constexpr ((kRouting & ModMatrix::kRouteGain) != 0) {
+        gain += gainStep;
+      }
+
+      if (!voice.active) {
+        break;
       }
     }
-    
-    // DC offset removal and clipping protection
-    sampleL = std::min(1.f, std::max(-1.f, sampleL));
-    sampleR = std::min(1.f, std::max(-1.f, sampleR));
 
-    // Write output
-    outL[i] = sampleL;
-    outR[i] = sampleR;
+    expression.syncBlep = syncBlep;
   }
+}
 
-  return kResultOk;
+//-----------------------------------------------------------------------------
+// How loud a voice currently is, to pick the one to steal
+static inline float voiceLoudness(const Voice& voice,
+                                  const VoiceExpression& expression) {
+  return voice.envelopeLevel * (expression.gainL + expression.gainR);
+}
+
+//-----------------------------------------------------------------------------
+int32 LaserProcessor::findFreeVoice() const {
+  int32 quietest = 0;
+  float quietestLoudness = 0.f;
+  int32 quietestRank = 0;
+
+  for (int32 v = 0; v < kNbrVoices; ++v) {
+    if (!voices[v].active) {
+      return v;
+    }
+
+    // Fading voices are taken over first, then the ones whose note has
+    // ended and only a pedal holds, then the quietest
+    int32 rank = 0;
+    if (voices[v].envelopePhase == kStealPhase) {
+      rank = 2;
+    } else if (mPedalHeldVoices & (1u << v)) {
+      rank = 1;
+    }
+    float loudness = voiceLoudness(voices[v], expressions[v]);
+    if (v == 0 || rank > quietestRank ||
+        (rank == quietestRank && loudness < quietestLoudness)) {
+      quietest = v;
+      quietestLoudness = loudness;
+      quietestRank = rank;
+    }
+  }
+  return quietest;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::limitVoices(int32 maxVoices) {
+  for (;;) {
+    int32 playing = 0;
+    int32 quietest = -1;
+    for (int32 v = 0; v < kNbrVoices; ++v) {
+      if (!voices[v].active || voices[v].envelopePhase == kStealPhase) {
+        continue;
+      }
+      playing++;
+      if (quietest < 0 || voiceLoudness(voices[v], expressions[v]) <
+                              voiceLoudness(voices[quietest],
+                                            expressions[quietest])) {
+        quietest = v;
+      }
+    }
+
+    if (playing <= maxVoices) {
+      return;
+    }
+    voices[quietest].envelopePhase = kStealPhase;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int32 LaserProcessor::getOscCoupling() const {
+  return std::min((int32) (fOscCoupling * (kNumOscCouplings - 1) + 0.5f),
+                  kNumOscCouplings - 1);
+}
+
+//-----------------------------------------------------------------------------
+int32 LaserProcessor::getMpeLayout() const {
+  return std::min((int32) (fMpeZone * (kNumMpeLayouts - 1) + 0.5f),
+                  kNumMpeLayouts - 1);
+}
+
+//-----------------------------------------------------------------------------
+bool LaserProcessor::acceptsChannel(int16 channel) const {
+  int32 members =
+      1 + (int32) (fMpeMemberChannels * (kMaxMpeMemberChannels - 1) + 0.5f);
+
+  switch (getMpeLayout()) {
+    case kMpeLowerZone:
+      // Master channel 0, members 1..members
+      return channel <= members;
+
+    case kMpeUpperZone:
+      // Master channel 15, members 14 downwards
+      return channel >= 15 - members;
+
+    default:
+      return true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::applyNoteExpression(VoiceExpression& expression,
+                                         NoteExpressionTypeID type,
+                                         float value) {
+  switch (type) {
+    case kTuningTypeID:
+      // 0.5 is no tuning, 0 and 1 are -120 and +120 semitones
+      expression.tuning = exp2f(240.f * (value - 0.5f) / 12.f);
+      break;
+
+    case kVolumeTypeID:
+      // 0.25 is unity gain, 1 is +12 dB
+      expression.volume = 4.f * value;
+      break;
+
+    case kPanTypeID:
+      expression.pan = value;
+      break;
+
+    case kBrightnessTypeID:
+      // 0.5 is neutral, 0 mutes and 1 doubles Oscillator 2
+      expression.brightness = 2.f * value;
+      break;
+
+    case kExpressionTypeID:
+      // Pressure only ever adds level: unity at rest, +6 dB when maxed
+      expression.pressure = 1.f + value;
+      break;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::carveBuffers(Arena& arena) {
+  // Mix bus, one block long
+  mMixL = arena.carve<Sample32>(processSetup.maxSamplesPerBlock);
+  mMixR = arena.carve<Sample32>(processSetup.maxSamplesPerBlock);
+
+  // Effect delay lines, sized for the sample rate
+  mChorus.carve(arena, processSetup.sampleRate);
+  mDelay.carve(arena, processSetup.sampleRate);
+
+  // Modulation lanes, one point per sub-block
+  mModMatrix.carve(arena, processSetup.maxSamplesPerBlock);
+
+  // Event batch, its sort histogram is one block long
+  mEvents.carve(arena, processSetup.maxSamplesPerBlock);
+
+  // Flight recorder ring, independent of the block size. The session
+  // capture queue is only allocated once a capture is asked for.
+  mRecorder.carve(arena);
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::captureFlightState(FlightBlockHeader& header) const {
+  header.numStateValues = getStateValues(header.state);
+  for (int32 v = 0; v < kNbrVoices; ++v) {
+    header.voices[v] = voices[v];
+    header.expressions[v] = expressions[v];
+  }
+  header.lfoPhases[0] = mModMatrix.getLfoPhase(0);
+  header.lfoPhases[1] = mModMatrix.getLfoPhase(1);
+  header.chorusPhase = mChorus.getPhase();
+  if (!mChorus.isBypassed() || !mDelay.isBypassed()) {
+    header.flags |= kFlightEffectsOn;  // Their lines are not recorded
+  }
+  header.governorLevel = mGovernor.getLevel();
+  header.wasPlaying = mWasPlaying ? 1 : 0;
+  header.bypassGain = fBypassGain;
+  for (int32 r = 0; r < kNumRampParams; r++) {
+    header.rampValues[r] = mRamps[r].value;
+    header.rampTargets[r] = mRamps[r].target;
+  }
+  header.pedals = (mSustainOn ? 1u : 0u) | (mSostenutoOn ? 2u : 0u);
+  header.pedalHeldVoices = mPedalHeldVoices;
+  header.sostenutoVoices = mSostenutoVoices;
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::beginSessionCapture() {
+  static constexpr std::array<ParamID, kNumParams> kParamIds = [] {
+    std::array<ParamID, kNumParams> ids = {};
+    for (int32 i = 0; i < kNumParams; i++) {
+      ids[i] = kParamTable[i].id;
+    }
+    return ids;
+  }();
+
+  SessionStart start;
+  start.sampleRate = processSetup.sampleRate;
+  start.maxSamplesPerBlock = processSetup.maxSamplesPerBlock;
+  start.processMode = processSetup.processMode;
+  start.symbolicSampleSize = processSetup.symbolicSampleSize;
+  for (int32 group = 0; group < kNumVoiceGroups; group++) {
+    if (mGroupBusActive[group]) {
+      start.groupBuses |= 1 << group;
+    }
+  }
+  start.numParams = kNumParams;
+
+  // Without room now it is tried again next block
+  mSession.begin(start, kParamIds.data(), mParamValues);
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::restoreFlightState(const FlightBlockHeader& header) {
+  setStateValues(header.state,
+                 std::min(header.numStateValues, kNumStateValues));
+  for (int32 v = 0; v < kNbrVoices; ++v) {
+    voices[v] = header.voices[v];
+    expressions[v] = header.expressions[v];
+  }
+  mModMatrix.setLfoPhase(0, header.lfoPhases[0]);
+  mModMatrix.setLfoPhase(1, header.lfoPhases[1]);
+  mChorus.setPhase(header.chorusPhase);
+  forceQualityLevel(header.governorLevel);
+  mWasPlaying = header.wasPlaying != 0;
+  fBypassGain = header.bypassGain;
+  for (int32 r = 0; r < kNumRampParams; r++) {
+    mRamps[r].value = header.rampValues[r];
+    mRamps[r].target = header.rampTargets[r];
+  }
+  mSustainOn = (header.pedals & 1u) != 0;
+  mSostenutoOn = (header.pedals & 2u) != 0;
+  mPedalHeldVoices = header.pedalHeldVoices;
+  mSostenutoVoices = header.sostenutoVoices;
+  mRecorder.setArmed(false);
+}
+
+//-----------------------------------------------------------------------------
+void LaserProcessor::forceQualityLevel(int32 level) {
+  mGovernor.forceLevel(level);
+  mQualityForced = true;
 }
 
 //-----------------------------------------------------------------------------
 tresult PLUGIN_API
 LaserProcessor::setupProcessing(ProcessSetup& newSetup) {
   //--- called before any processing ----
-  return AudioEffect::setupProcessing(newSetup);
+  tresult result = AudioEffect::setupProcessing(newSetup);
+  if (result != kResultOk) {
+    return result;
+  }
+
+  // Measuring pass: carving from an arena without memory only adds up the
+  // sizes, the real allocation happens in setActive(true)
+  Arena sizing;
+  carveBuffers(sizing);
+  mArenaSize = sizing.getUsed();
+
+  // Envelope steps only depend on the sample rate
+  const float sampleRate = (float) newSetup.sampleRate;
+  fAttackStep = 1.f / (Voice::attackTime * sampleRate);
+  fReleaseFactor = expf(-5.f / (Voice::releaseTime * sampleRate));
+  fStealFactor = expf(-5.f / (Voice::stealTime * sampleRate));
+  fBypassStep = 1.f / (kBypassFadeTime * sampleRate);
+  fRampCoefficient =
+      1.f - expf(-(float) ModMatrix::kSubBlockSize / (kRampTime * sampleRate));
+
+  mGovernor.setup(newSetup.sampleRate);
+  mTuning.setup(newSetup.sampleRate);
+
+  return kResultOk;
 }
 
 //-----------------------------------------------------------------------------
@@ -319,57 +1371,60 @@ LaserProcessor::canProcessSampleSize(int32 symbolicSampleSize) {
 }
 
 //-----------------------------------------------------------------------------
-tresult PLUGIN_API LaserProcessor::setState(IBStream* state) {
-  if (!state) {
-    return kResultFalse;
-  }
+int32 LaserProcessor::getStateValues(float* values) const {
+  static_assert(kNumStateValues <= FlightBlockHeader::kMaxStateValues,
+                "The flight recorder must hold the whole state");
 
-  // called when we load a preset, the model has to be reloaded
-  IBStreamer streamer(state, kLittleEndian);
-  
-  float fval;
-
-  if (streamer.readFloat(fval) == false) {
-    return kResultFalse;
+  for (int32 i = 0; i < kNumStateValues; i++) {
+    const int32 index = kStateOrder[i];
+    values[i] = toStateValue(kParamTable[index], mParamValues[index]);
   }
+  return kNumStateValues;
+}
 
-  kWaveFormType = static_cast<int>(fval);
-
-  float savedParamGain = 0.f;
-  if (streamer.readFloat(savedParamGain) == false) {
-    return kResultFalse;
+//-----------------------------------------------------------------------------
+void LaserProcessor::setStateValues(const float* values, int32 count) {
+  count = std::min(count, kNumStateValues);
+  for (int32 i = 0; i < count; i++) {
+    const ParamSpec& spec = kParamTable[kStateOrder[i]];
+    applyParameter(spec.id, fromStateValue(spec, values[i]));
   }
-  
-  mGain = savedParamGain;
+}
 
-  if (streamer.readFloat(fval) == false) {
+//-----------------------------------------------------------------------------
+tresult PLUGIN_API LaserProcessor::setState(IBStream* state) {
+  if (!state) {
     return kResultFalse;
   }
 
-  fOsc1 = fval;
+  // called when we load a preset, the model has to be reloaded
+  IBStreamer streamer(state, kLittleEndian);
 
-  if (streamer.readFloat(fval) == false) {
+  // Waveform, gain and both oscillators are mandatory, older states end
+  // anywhere after them
+  float values[kNumStateValues];
+  int32 count = 0;
+  while (count < kNumStateValues && streamer.readFloat(values[count])) {
+    count++;
+  }
+  if (count < kNumRequiredStateParams) {
     return kResultFalse;
   }
 
-  fOsc2 = fval;
-
+  setStateValues(values, count);
   return kResultOk;
 }
 
 //-----------------------------------------------------------------------------
 tresult PLUGIN_API LaserProcessor::getState(IBStream* state) {
   // here we need to save the model (preset or project)
-  float toSaveParamGain = mGain;
+  float values[kNumStateValues];
+  int32 count = getStateValues(values);
 
   IBStreamer streamer(state, kLittleEndian);
-  
-  streamer.writeFloat(static_cast<float>(kWaveFormType));
-
-  streamer.writeFloat(toSaveParamGain);
-
-  streamer.writeFloat(fOsc1);
-  streamer.writeFloat(fOsc2);
+  for (int32 i = 0; i < count; i++) {
+    streamer.writeFloat(values[i]);
+  }
 
   return kResultOk;
 }
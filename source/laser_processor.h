@@ -9,16 +9,31 @@
  * gain.
  *
  * @details
- * The Laser Processor supports up to 8 voices for polyphony. It generates
+ * The Laser Processor plays up to 8 notes at once. It generates
  * oscillating signals based on frequency parameters and gain values,
  * dynamically allocating voices based on MIDI NoteOn and NoteOff events. It
  * also supports state saving and restoration.
  *
  * Features:
- * - Polyphonic voice management with up to 8 voices.
+ * - Polyphonic voice management with up to 8 notes; stolen notes fade out
+ *   on spare voices.
  * - Real-time parameter updates for gain and oscillator frequencies.
+ * - Parameter dispatch generated from the parameter table at compile time,
+ *   with ramped levels.
  * - Handles MIDI events (NoteOn/NoteOff) to trigger and release voices.
+ * - Sustain and sostenuto pedals, and a smoothed pitch bend.
+ * - Coalesces note storms before voice allocation.
+ * - Per-voice note expressions and MPE zones.
  * - Supports stereo audio output and automation-ready parameters.
+ * - Click-free host bypass, and a soft all notes off on transport stop.
+ * - Optional per-voice-group output buses (notes below/above a split key).
+ * - Decimated output capture for the editor's scope view.
+ * - Adaptive polyphony driven by the measured DSP load.
+ * - Flight recorder of the last blocks, replayable offline.
+ * - Streaming capture of the host inputs, to replay real sessions.
+ * - Oscillator coupling: phase modulation, ring modulation and hard sync.
+ * - Built-in chorus and tempo-synced stereo delay on the mix bus.
+ * - Modulation matrix with LFO, envelope and velocity sources.
  *
  * Dependencies:
  * - Steinberg VST3 SDK
@@ -34,9 +49,25 @@
 #ifndef LASER_PROCESSOR_H_
 #define LASER_PROCESSOR_H_
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "arena.h"
+#include "effects.h"
+#include "event_batch.h"
+#include "flight_recorder.h"
+#include "governor.h"
+#include "modulation.h"
+#include "param_table.h"
 #include "params.h"
+#include "scope.h"
+#include "session_recorder.h"
+#include "tuning.h"
 #include "voice.h"
 
+#include "pluginterfaces/vst/ivstnoteexpression.h"
 #include "public.sdk/source/vst/vstaudioeffect.h"
 
 // The `std` namespace is used for standard library components
@@ -48,20 +79,17 @@ using namespace Steinberg;
 using namespace Vst;
 
 // Define a constant for the number of voices used in the plugin.
-static const int kNbrVoices = 8;  // A fixed number of voices for the plugin
-                                  // (e.g., 8 voices for polyphony).
+static const int kMaxPolyphony = 8;  // Notes playing at once, at most.
+// Voices that only finish the fade of a stolen note, so a new note never
+// has to cut one short. One per note of a full chord change.
+static const int kNumSpareVoices = kMaxPolyphony;
+static const int kNbrVoices = kMaxPolyphony + kNumSpareVoices;
 
 // Mathematical constants
-#define PI2 (3.14159265f * 2.f)
-
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-// MIDI constants
-constexpr int kMIDINoteA4 = 69;         ///< MIDI note number for A4 (440 Hz).
-constexpr float kFrequencyA4 = 440.0f;  ///< Frequency of A4 in Hz.
-
 namespace Radar {
 
 /**
@@ -86,6 +114,8 @@ class LaserProcessor : public AudioEffect {
   tresult PLUGIN_API terminate() SMTG_OVERRIDE;
   tresult PLUGIN_API setActive(TBool state) SMTG_OVERRIDE;
   tresult PLUGIN_API setupProcessing(ProcessSetup& newSetup) SMTG_OVERRIDE;
+  tresult PLUGIN_API activateBus(MediaType type, BusDirection dir,
+                                 int32 index, TBool state) SMTG_OVERRIDE;
   tresult PLUGIN_API canProcessSampleSize(int32 symbolicSampleSize) SMTG_OVERRIDE;
   tresult PLUGIN_API process(ProcessData& data) SMTG_OVERRIDE;
 
@@ -93,24 +123,285 @@ class LaserProcessor : public AudioEffect {
   tresult PLUGIN_API setState(IBStream* state) SMTG_OVERRIDE;
   tresult PLUGIN_API getState(IBStream* state) SMTG_OVERRIDE;
 
+  // Connection to the controller
+  tresult PLUGIN_API connect(IConnectionPoint* other) SMTG_OVERRIDE;
+  tresult PLUGIN_API disconnect(IConnectionPoint* other) SMTG_OVERRIDE;
+  tresult PLUGIN_API notify(IMessage* message) SMTG_OVERRIDE;
+
+  /**
+   * @brief Restores the DSP state a recorded block started from, for
+   * offline replay of a flight recorder dump.
+   *
+   * Also stops the recorder from dumping and holds the quality level, see
+   * forceQualityLevel(). The delay and chorus lines are not recorded and
+   * keep their content.
+   */
+  void restoreFlightState(const FlightBlockHeader& header);
+
+  /// Holds the quality level at `level` instead of measuring the load.
+  void forceQualityLevel(int32 level);
+
  protected:
-  // Parameters and voice settings
-  ParamValue kWaveFormType = WaveType::kSine;  ///< Gain parameter.
+  /// Number of values of the state, see getStateValues().
+  static constexpr int32 kNumStateValues = kNumStateParams;
+
+  /// Time constant of the kRamp parameter ramps, in seconds.
+  static constexpr float kRampTime = 0.005f;
+
+  /// Length of the bypass crossfade, in seconds.
+  static constexpr float kBypassFadeTime = 0.01f;
+
+  /// Phase modulation depth at kPmDepth 1, in cycles.
+  static constexpr double kMaxPmCycles = 2.;
+
+  /**
+   * @brief Writes the parameters in state order into `values`, which holds
+   * kNumStateValues.
+   *
+   * @return Number of values written.
+   */
+  int32 getStateValues(float* values) const;
+
+  /**
+   * @brief Applies the first `count` values in state order. Values were
+   * appended over time, older states end early and keep the defaults.
+   */
+  void setStateValues(const float* values, int32 count);
+
+  /// Applies a normalized value of parameter `id`, ignores unknown IDs.
+  void applyParameter(ParamID id, ParamValue value);
+
+  /**
+   * @brief Applies the normalized `value` of the parameter at `index` in
+   * kParamTable.
+   */
+  using ParamHandler = void (LaserProcessor::*)(int32 index, ParamValue value);
+
+  /**
+   * @brief Handler of every parameter, indexed like kParamTable, nullptr
+   * for the read-only ones. Evaluated at compile time.
+   */
+  static constexpr std::array<ParamHandler, kNumParams> makeParamHandlers();
+
+  // Parameter handlers
+  template <float LaserProcessor::*kField>
+  void setField(int32 /*index*/, ParamValue value) {
+    this->*kField = (float) value;
+  }
+  void setRamped(int32 index, ParamValue value);
+  void setWaveForm(int32 index, ParamValue value);
+  void setModulation(int32 index, ParamValue value);
+  void setFlightDump(int32 index, ParamValue value);
+  void setSessionCapture(int32 index, ParamValue value);
+  void setSustain(int32 index, ParamValue value);
+  void setSostenuto(int32 index, ParamValue value);
+
+  /// Releases the voices whose note ended while a pedal held them.
+  void releasePedalVoices();
+
+  /// Moves every parameter ramp one sub-block towards its target.
+  void advanceRamps();
+
+  /// Ends every parameter ramp at its target.
+  void snapRamps();
+
+  /// Snapshots the DSP state at the start of a block for the recorder.
+  void captureFlightState(FlightBlockHeader& header) const;
+
+  /// Starts a session capture from the current setup and parameters.
+  void beginSessionCapture();
+
+  /**
+   * @brief Where each voice group renders to: the mix bus, or directly the
+   * host buffers of its own output bus.
+   */
+  struct RenderTargets {
+    Sample32* left[kNumVoiceGroups];
+    Sample32* right[kNumVoiceGroups];
+  };
+
+  /**
+   * @brief Renders the voices and the effects of a whole block into the
+   * main output and the active group buses in `groupBuses`.
+   *
+   * @return Bit mask of the voice groups that had a voice sounding.
+   */
+  uint32 renderBlock(ProcessData& data, uint32 groupBuses);
+
+  /// Zeroes the main output and the active group buses and flags them silent.
+  static void clearOutputs(ProcessData& data, uint32 groupBuses);
+
+  /// Ramps the rendered outputs towards the gain the bypass asks for.
+  void applyBypassFade(ProcessData& data, uint32 groupBuses);
+
+  /// Fades every playing voice out quickly, like a stolen one.
+  void releaseAllVoices();
+
+  /**
+   * @brief Renders all active voices into the targets of their groups.
+   *
+   * Group bus targets are cleared first, the mix bus must already be.
+   * `numSamples` must not exceed the size of the carved mix buffers.
+   *
+   * @return Bit mask of the voice groups that had a voice sounding.
+   */
+  uint32 renderVoices(const RenderTargets& targets, int32 numSamples);
+
+  /**
+   * @brief Voice kernel for one sub-block, specialized on the modulation
+   * routing (a combination of ModMatrix::Routing bits) and the oscillator
+   * coupling (OscCoupling).
+   *
+   * `offset` is the position of the sub-block in the targets and `point` its
+   * index in the modulation lanes.
+   */
+  template <uint32 kRouting, int32 kCoupling>
+  void renderSubBlock(const RenderTargets& targets, int32 offset,
+                      int32 numSamples, int32 point);
+
+  using Kernel =
+      void (LaserProcessor::*)(const RenderTargets&, int32, int32, int32);
+
+  /// Kernels of one coupling for every routing, indexed by routing.
+  template <int32 kCoupling, uint32... kRoutings>
+  static constexpr std::array<Kernel, ModMatrix::kNumRoutings> makeKernels(
+      std::integer_sequence<uint32, kRoutings...>) {
+    return {{&LaserProcessor::renderSubBlock<kRoutings, kCoupling>...}};
+  }
+
+  /// Oscillator coupling (OscCoupling) selected by the parameters.
+  int32 getOscCoupling() const;
+
+  /// MPE zone layout (MpeLayout) selected by the parameters.
+  int32 getMpeLayout() const;
+
+  /// Whether notes on `channel` belong to the configured MPE zone.
+  bool acceptsChannel(int16 channel) const;
+
+  /**
+   * @brief Voice for a new note: the first inactive one. With the spare
+   * voices there is one unless more notes were stolen at once than there
+   * are spares; then it is the quietest one that is already fading out,
+   * then the quietest one only a pedal still holds, then the quietest one.
+   */
+  int32 findFreeVoice() const;
+
+  /// Fades out the quietest voices until at most `maxVoices` are playing.
+  void limitVoices(int32 maxVoices);
+
+  /// Applies one note event of the prepared batch to the voices.
+  void handleEvent(const Event& event);
+
+  /// Updates the expression lane of a voice from a note expression value.
+  static void applyNoteExpression(VoiceExpression& expression,
+                                  NoteExpressionTypeID type, float value);
 
-  // Array of `Voice` objects with a size defined by `kNbrVoices` (default 8).
-  Voice voices[kNbrVoices];
+  /**
+   * @brief Carves every DSP buffer of the instance from `arena`.
+   *
+   * Called once on an empty arena to measure and once on the allocated
+   * arena to hand out the memory, so both passes always agree.
+   */
+  void carveBuffers(Arena& arena);
 
-  ParamValue mGain = default_Gain;  ///< Gain parameter.
+  // Hot state: read and written on every sample of every block. It starts
+  // on a cache line of its own and the class size is padded to a whole
+  // number of lines, so processors running on different worker threads never
+  // share (and ping-pong) a line.
+
+  // Array of `Voice` objects with a size defined by `kNbrVoices`: the
+  // kMaxPolyphony playing voices and the spare ones, 16 in all.
+  alignas(kCacheLineSize) Voice voices[kNbrVoices];
+
+  // Note identity and note expression lane of each voice
+  VoiceExpression expressions[kNbrVoices];
+
+  ParamValue kWaveFormType = WaveType::kSine;  ///< Waveform type.
   ParamValue mGainReduction = 0.f;  ///< Gain reduction.
 
-  // Oscillator parameters
-  float fOsc1 = default_Osc1;  ///< Oscillator 1 frequency multiplier.
-  float fOsc2 = default_Osc2;  ///< Oscillator 2 frequency multiplier.
-  float fOsc1Phase = 0.f;      ///< Phase for Oscillator 1.
-  float fOsc2Phase = 0.f;      ///< Phase for Oscillator 2.
-  float fFrequency = 0.f;      ///< Frequency value for the oscillator.
-  float fVolume = 0.2f;         ///< Volume level.
-  float fDeltaAngle = 0.f;     ///< Phase increment for oscillators.
+  // Gain, oscillator levels and phase modulation depth, by rampIndex()
+  ParamRamp mRamps[kNumRampParams];
+  float fRampCoefficient = 1.f;  ///< Ramp progress per sub-block.
+  float fBendRatio = 1.f;        ///< Pitch bend, as a frequency ratio.
+
+  // Pedals: bit v of the masks stands for voices[v]
+  uint32 mPedalHeldVoices = 0;  ///< Note ended, a pedal keeps it sounding.
+  uint32 mSostenutoVoices = 0;  ///< Held when the sostenuto went down.
+  bool mSustainOn = false;      ///< Sustain pedal down.
+  bool mSostenutoOn = false;    ///< Sostenuto pedal down.
+
+  // Envelope steps for the current sample rate
+  float fAttackStep = 0.f;     ///< Attack increment per sample.
+  float fReleaseFactor = 1.f;  ///< Release decay factor per sample.
+  float fStealFactor = 1.f;    ///< Steal fade decay factor per sample.
+
+  // Effect parameters, normalized
+  float fDelayMix = default_DelayMix;            ///< Delay wet level.
+  float fDelayTime = default_DelayTime;          ///< Delay time.
+  float fDelayFeedback = default_DelayFeedback;  ///< Delay feedback.
+  float fDelaySync = default_DelaySync;          ///< Delay tempo sync.
+  float fChorusMix = default_ChorusMix;          ///< Chorus wet level.
+  float fChorusRate = default_ChorusRate;        ///< Chorus LFO rate.
+  float fChorusDepth = default_ChorusDepth;      ///< Chorus depth.
+
+  // DSP buffers carved from the arena
+  Span<Sample32> mMixL;  ///< Left channel of the mix bus.
+  Span<Sample32> mMixR;  ///< Right channel of the mix bus.
+
+  // Post-mix effects
+  Chorus mChorus;      ///< Chorus, first in the chain.
+  StereoDelay mDelay;  ///< Delay, after the chorus.
+
+  ModMatrix mModMatrix;  ///< LFOs and modulation routing.
+
+  EventBatch mEvents;  ///< Events of the block, sorted and coalesced.
+
+  // Oscillator coupling, normalized
+  float fOscCoupling = default_OscCoupling;  ///< OscCoupling mode.
+  float fOscRatio = default_OscRatio;        ///< Oscillator 2 ratio.
+  double fOsc2Ratio = 2.;                    ///< fOscRatio as a ratio.
+
+  // Bypass crossfade
+  float fBypass = default_Bypass;  ///< Bypass parameter, normalized.
+  float fBypassGain = 1.f;         ///< Output gain, 0 once fully bypassed.
+  float fBypassStep = 0.f;         ///< Crossfade gain change per sample.
+  bool mWasPlaying = false;        ///< Transport state of the last block.
+
+  // MPE zone, normalized
+  float fMpeZone = default_MpeZone;                      ///< Zone layout.
+  float fMpeMemberChannels = default_MpeMemberChannels;  ///< Member count.
+
+  // Voice group routing
+  float fSplitKey = default_SplitKey;        ///< Split key, normalized.
+  bool mGroupBusActive[kNumVoiceGroups] = {};  ///< Set by activateBus().
+
+  ScopeCapture mScope;  ///< Output capture for the scope view.
+
+  // Adaptive quality
+  QualityGovernor mGovernor;                        ///< Load tracking.
+  float fGovernorEnabled = default_GovernorEnabled;  ///< On/off, normalized.
+
+  // Cold state: only touched on state changes, never per sample.
+  alignas(kCacheLineSize) TuningTable mTuning;  ///< Note increments.
+
+  // Normalized value of every parameter, indexed like kParamTable, for the
+  // state. The handlers keep the working copies above.
+  float mParamValues[kNumParams] = {};
+
+  Arena mArena;            ///< Owner of all DSP buffers of this instance.
+  size_t mArenaSize = 0;   ///< Bytes needed for the current ProcessSetup.
+
+  // Scope capture transport, and whether an editor wants the capture. The
+  // flag is written by notify() on the UI thread and read once per block.
+  std::unique_ptr<DataExchangeHandler> mScopeExchange;
+  std::atomic<bool> mScopeEnabled{false};
+
+  FlightRecorder mRecorder;      ///< Ring of the last blocks.
+  bool mFlightDumpOn = false;    ///< Last value of the dump parameter.
+  bool mQualityForced = false;   ///< Set by forceQualityLevel().
+
+  SessionRecorder mSession;        ///< Streaming capture of the inputs.
+  bool mSessionCaptureOn = false;  ///< Last value of the capture parameter.
 };
 
 }  // namespace Radar
@@ -0,0 +1,230 @@
+/**
+ * @file modulation.cpp
+ *
+ * @brief Implementation of the LFOs and the modulation matrix of the Laser
+ * VST Plugin.
+ *
+ * This file implements the Lfo and ModMatrix classes declared in
+ * modulation.h.
+ *
+ * @details
+ * Parameter changes update the slot table and recompute the routing mask
+ * and the summed per-voice source amounts, so nothing has to be looked up
+ * per slot while rendering. render() does nothing at all when no slot is
+ * active.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - Standard Math Library (math.h)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "modulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Radar {
+
+static const float kTwoPi = 6.28318530718f;
+
+/**
+ * @brief Converts a normalized list parameter into an index [0..count-1].
+ */
+static int32 toListIndex(float value, int32 count) {
+  return std::max(0, std::min((int32) (value * (count - 1) + 0.5f),
+                              count - 1));
+}
+
+//-----------------------------------------------------------------------------
+// Lfo
+//-----------------------------------------------------------------------------
+float Lfo::rateToHz(float normalized) {
+  return kMinRateHz * powf(kMaxRateHz / kMinRateHz, normalized);
+}
+
+//-----------------------------------------------------------------------------
+void Lfo::setRate(float normalized) { rateHz = rateToHz(normalized); }
+
+//-----------------------------------------------------------------------------
+void Lfo::setShape(float normalized) {
+  shape = toListIndex(normalized, kNumLfoShapes);
+}
+
+//-----------------------------------------------------------------------------
+float Lfo::valueAt(double lfoPhase) const {
+  float p = (float) lfoPhase;
+  switch (shape) {
+    case kLfoSine:
+    default:
+      return sinf(kTwoPi * p);
+
+    case kLfoTriangle:
+      return 4.f * fabsf(p - 0.5f) - 1.f;
+
+    case kLfoSaw:
+      return 2.f * p - 1.f;
+
+    case kLfoSquare:
+      return (p < 0.5f) ? 1.f : -1.f;
+  }
+}
+
+//-----------------------------------------------------------------------------
+float Lfo::valueAhead(int32 numSamples, SampleRate sampleRate) const {
+  double p = phase + rateHz * numSamples / sampleRate;
+  return valueAt(p - floor(p));
+}
+
+//-----------------------------------------------------------------------------
+void Lfo::advance(int32 numSamples, SampleRate sampleRate) {
+  phase += rateHz * numSamples / sampleRate;
+  phase -= floor(phase);
+}
+
+//-----------------------------------------------------------------------------
+// ModMatrix
+//-----------------------------------------------------------------------------
+ModMatrix::ModMatrix() {
+  for (int32 i = 0; i < 2; i++) {
+    lfoParams[i * 2] = default_LfoRate;
+    lfoParams[i * 2 + 1] = default_LfoShape;
+    lfos[i].setRate(default_LfoRate);
+    lfos[i].setShape(default_LfoShape);
+  }
+  for (int32 slot = 0; slot < kNumModSlots; slot++) {
+    slotParams[slot * kModSlotStride + kModSlotSource] = default_ModSource;
+    slotParams[slot * kModSlotStride + kModSlotDestination] =
+        default_ModDestination;
+    slotParams[slot * kModSlotStride + kModSlotAmount] = default_ModAmount;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ModMatrix::carve(Arena& arena, int32 maxSamplesPerBlock) {
+  // One point per sub-block boundary, including the end of the block
+  laneSize = (maxSamplesPerBlock + kSubBlockSize - 1) / kSubBlockSize + 1;
+  lanes = arena.carve<Sample32>(kNumModDestinations * laneSize);
+}
+
+//-----------------------------------------------------------------------------
+bool ModMatrix::setParameter(ParamID id, float value) {
+  if (id >= kLfo1Rate && id <= kLfo2Shape) {
+    int32 index = id - kLfo1Rate;
+    lfoParams[index] = value;
+
+    // Rate and shape alternate per LFO
+    if (index % 2 == 0) {
+      lfos[index / 2].setRate(value);
+    } else {
+      lfos[index / 2].setShape(value);
+    }
+    return true;
+  }
+
+  if (id >= kModSlotFirst && id <= kModSlotLast) {
+    int32 index = id - kModSlotFirst;
+    slotParams[index] = value;
+
+    Slot& slot = slots[index / kModSlotStride];
+    switch (index % kModSlotStride) {
+      case kModSlotSource:
+        slot.source = toListIndex(value, kNumModSources);
+        break;
+
+      case kModSlotDestination:
+        slot.destination = toListIndex(value, kNumModDestinations);
+        break;
+
+      case kModSlotAmount:
+        slot.amount = value * 2.f - 1.f;
+        break;
+    }
+
+    updateRouting();
+    return true;
+  }
+
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+float ModMatrix::getParameter(ParamID id) const {
+  if (id >= kLfo1Rate && id <= kLfo2Shape) {
+    return lfoParams[id - kLfo1Rate];
+  }
+  if (id >= kModSlotFirst && id <= kModSlotLast) {
+    return slotParams[id - kModSlotFirst];
+  }
+  return 0.f;
+}
+
+//-----------------------------------------------------------------------------
+void ModMatrix::updateRouting() {
+  routing = 0;
+  std::fill(envelopeAmount, envelopeAmount + kNumModDestinations, 0.f);
+  std::fill(velocityAmount, velocityAmount + kNumModDestinations, 0.f);
+
+  for (const Slot& slot : slots) {
+    if (slot.source == kModSourceNone || slot.destination == kModDestNone ||
+        slot.amount == 0.f) {
+      continue;
+    }
+
+    switch (slot.destination) {
+      case kModDestPitch:
+        routing |= kRoutePitch;
+        break;
+
+      case kModDestOsc1Level:
+      case kModDestOsc2Level:
+        routing |= kRouteLevels;
+        break;
+
+      case kModDestGain:
+        routing |= kRouteGain;
+        break;
+    }
+
+    if (slot.source == kModSourceEnvelope) {
+      envelopeAmount[slot.destination] += slot.amount;
+    } else if (slot.source == kModSourceVelocity) {
+      velocityAmount[slot.destination] += slot.amount;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ModMatrix::render(int32 numSamples, SampleRate sampleRate) {
+  // A slot assigned later picks the LFO up where it would be anyway
+  if (routing == 0) {
+    advance(numSamples, sampleRate);
+    return;
+  }
+
+  int32 numPoints = (numSamples + kSubBlockSize - 1) / kSubBlockSize + 1;
+  std::fill(lanes.begin(), lanes.end(), 0.f);
+
+  for (int32 point = 0; point < numPoints; point++) {
+    int32 offset = std::min(point * kSubBlockSize, numSamples);
+    float lfoValues[2] = {lfos[0].valueAhead(offset, sampleRate),
+                          lfos[1].valueAhead(offset, sampleRate)};
+
+    for (const Slot& slot : slots) {
+      if (slot.source == kModSourceLfo1 || slot.source == kModSourceLfo2) {
+        lane(slot.destination)[point] +=
+            slot.amount * lfoValues[slot.source - kModSourceLfo1];
+      }
+    }
+  }
+
+  advance(numSamples, sampleRate);
+}
+
+//-----------------------------------------------------------------------------
+}  // namespace Radar
@@ -0,0 +1,188 @@
+/**
+ * @file modulation.h
+ *
+ * @brief Declaration of the LFOs and the modulation matrix of the Laser VST
+ * Plugin.
+ *
+ * This file defines the Lfo class and the ModMatrix class, which route the
+ * LFOs, the amplitude envelope and the velocity of each voice to pitch,
+ * oscillator levels and gain.
+ *
+ * @details
+ * Modulation is evaluated at sub-block rate: every kSubBlockSize samples.
+ * The global sources (the LFOs) are rendered once per block into one lane
+ * per destination, holding the value at every sub-block boundary. The
+ * per-voice sources (envelope, velocity) are folded in when a voice starts a
+ * sub-block, so the per-sample loop only ever sees ramps.
+ *
+ * The matrix also reports which destination groups are routed at all
+ * (getRouting()). The voice kernel is instantiated once per combination, so
+ * destinations without a routing add no work to the per-sample loop.
+ *
+ * Features:
+ * - Two LFOs with sine, triangle, saw and square shapes.
+ * - kNumModSlots slots with source, destination and bipolar amount.
+ * - Sub-block rate evaluation into arena-backed lanes.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef MODULATION_H_
+#define MODULATION_H_
+
+#include "arena.h"
+#include "params.h"
+
+#include "pluginterfaces/vst/vsttypes.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/**
+ * @class Lfo
+ * @brief Free running low frequency oscillator.
+ */
+class Lfo {
+ public:
+  static constexpr float kMinRateHz = 0.05f;  ///< Rate at 0.
+  static constexpr float kMaxRateHz = 20.f;   ///< Rate at 1.
+
+  /// Sets the rate from a normalized value.
+  void setRate(float normalized);
+
+  /// Sets the shape from a normalized value.
+  void setShape(float normalized);
+
+  /// Value [-1..1] `numSamples` ahead of the current phase.
+  float valueAhead(int32 numSamples, SampleRate sampleRate) const;
+
+  /// Moves the phase forward by `numSamples`.
+  void advance(int32 numSamples, SampleRate sampleRate);
+
+  /// Phase [0..1), for the flight recorder.
+  double getPhase() const { return phase; }
+
+  /// Restores a phase returned by getPhase().
+  void setPhase(double newPhase) { phase = newPhase; }
+
+  /// Converts a normalized rate into Hz.
+  static float rateToHz(float normalized);
+
+ private:
+  float valueAt(double lfoPhase) const;
+
+  double phase = 0.;   ///< Phase [0..1).
+  float rateHz = 1.f;  ///< Rate in Hz.
+  int32 shape = kLfoSine;
+};
+
+/**
+ * @class ModMatrix
+ * @brief Routes modulation sources to destinations through kNumModSlots
+ * slots.
+ */
+class ModMatrix {
+ public:
+  static constexpr int32 kSubBlockSize = 32;  ///< Evaluation interval.
+  static constexpr float kPitchRange = 1.f;   ///< Octaves at amount 1.
+
+  /**
+   * @brief Destination groups, one bit each, used to pick the voice kernel.
+   */
+  enum Routing : uint32 {
+    kRoutePitch = 1 << 0,   ///< Pitch is modulated.
+    kRouteLevels = 1 << 1,  ///< Oscillator levels are modulated.
+    kRouteGain = 1 << 2,    ///< Voice gain is modulated.
+    kNumRoutings = 1 << 3
+  };
+
+  ModMatrix();
+
+  /// Carves the modulation lanes for blocks of up to `maxSamplesPerBlock`.
+  void carve(Arena& arena, int32 maxSamplesPerBlock);
+
+  /**
+   * @brief Applies a normalized LFO or matrix slot parameter.
+   *
+   * @return false if `id` is not a modulation parameter.
+   */
+  bool setParameter(ParamID id, float value);
+
+  /// Normalized value of a modulation parameter, for state saving.
+  float getParameter(ParamID id) const;
+
+  /// Whether `id` belongs to the LFOs or the matrix.
+  static constexpr bool isModulationParameter(ParamID id) {
+    return (id >= kLfo1Rate && id <= kLfo2Shape) ||
+           (id >= kModSlotFirst && id <= kModSlotLast);
+  }
+
+  /// Phase of LFO `index` (0 or 1), for the flight recorder.
+  double getLfoPhase(int32 index) const { return lfos[index].getPhase(); }
+
+  /// Restores a phase returned by getLfoPhase().
+  void setLfoPhase(int32 index, double phase) { lfos[index].setPhase(phase); }
+
+  /// Destination groups routed by at least one active slot.
+  uint32 getRouting() const { return routing; }
+
+  /**
+   * @brief Renders the global sources of the next `numSamples` into the
+   * lanes and advances the LFOs, which run even while nothing is routed.
+   */
+  void render(int32 numSamples, SampleRate sampleRate);
+
+  /// Only advances the LFOs by `numSamples`, for blocks that render nothing.
+  void advance(int32 numSamples, SampleRate sampleRate) {
+    lfos[0].advance(numSamples, sampleRate);
+    lfos[1].advance(numSamples, sampleRate);
+  }
+
+  /**
+   * @brief Modulation of `destination` at sub-block boundary `point` for a
+   * voice with the given envelope level and velocity.
+   */
+  float voiceValue(int32 destination, int32 point, float envelope,
+                   float velocity) const {
+    return lane(destination)[point] + envelopeAmount[destination] * envelope +
+           velocityAmount[destination] * velocity;
+  }
+
+ private:
+  struct Slot {
+    int32 source = kModSourceNone;
+    int32 destination = kModDestNone;
+    float amount = 0.f;  ///< Bipolar [-1..1].
+  };
+
+  Sample32* lane(int32 destination) const {
+    return lanes.data + destination * laneSize;
+  }
+
+  /// Recomputes routing and the per-voice source amounts.
+  void updateRouting();
+
+  Lfo lfos[2];
+  Slot slots[kNumModSlots];
+  float lfoParams[4];                            ///< Normalized LFO params.
+  float slotParams[kNumModSlots * kModSlotStride];  ///< Normalized slots.
+  float envelopeAmount[kNumModDestinations] = {};
+  float velocityAmount[kNumModDestinations] = {};
+  uint32 routing = 0;
+
+  Span<Sample32> lanes;  ///< kNumModDestinations lanes of laneSize points.
+  int32 laneSize = 0;
+};
+
+}  // namespace Radar
+
+#endif  // MODULATION_H_
@@ -0,0 +1,598 @@
+/**
+ * @file param_table.h
+ *
+ * @brief Declarative parameter table of the Laser VST Plugin.
+ *
+ * This file defines kParamTable, which describes every parameter of Laser
+ * once for both the processor and the controller: its ID, title, plain range,
+ * taper, unit, default value, smoothing policy and place in the state.
+ *
+ * @details
+ * The controller registers, converts and formats its parameters from the
+ * table (see TableParameter). The processor builds its parameter dispatch
+ * from it at compile time and smooths the parameters that ask for it. Both
+ * serialize their state through it. Adding a parameter means adding a row
+ * here, and a handler in the processor unless it is read-only.
+ *
+ * The table is in registration order, which is what hosts list. The
+ * component state stores the parameters in `stateIndex` order instead:
+ * positions were assigned as parameters were added over time, and a new
+ * parameter takes the next free one, so older states simply end early.
+ *
+ * Features:
+ * - Linear, exponential and list tapers with normalized <-> plain conversion.
+ * - Display as plain numbers, decibels or note names.
+ * - Smoothing policy per parameter: none, once per block or ramped.
+ * - Compile-time ID lookup, state order and consistency checks.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - Standard Math Library (cmath)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef PARAM_TABLE_H_
+#define PARAM_TABLE_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "effects.h"
+#include "governor.h"
+#include "modulation.h"
+#include "params.h"
+
+#include "pluginterfaces/vst/ivsteditcontroller.h"
+#include "pluginterfaces/vst/vsttypes.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/**
+ * @enum ParamTaper
+ * @brief How the normalized value maps to the plain value.
+ */
+enum class ParamTaper : uint8 {
+  kLinear,       ///< Proportional, snapped to the steps if there are any.
+  kExponential,  ///< Equal ratios for equal travel: times, rates, ratios.
+  kList          ///< Named entries, the plain value is the entry index.
+};
+
+/**
+ * @enum ParamFormat
+ * @brief How the plain value is shown.
+ */
+enum class ParamFormat : uint8 {
+  kNumber,   ///< With `precision` decimals.
+  kDecibel,  ///< A linear gain, shown in dB.
+  kNote      ///< A MIDI note number, shown as a note name (60 is C3).
+};
+
+/**
+ * @enum ParamSmoothing
+ * @brief How the processor applies new values of a parameter.
+ *
+ * kNone and kBlock parameters are both applied as they arrive at the start
+ * of the block. kRamp parameters are read by the voice kernel directly and
+ * follow their new value through a ParamRamp instead of jumping to it.
+ */
+enum class ParamSmoothing : uint8 {
+  kNone,   ///< Switches, lists and steps, never interpolated.
+  kBlock,  ///< Read once per block by the effects and the modulation.
+  kRamp    ///< Ramped at sub-block rate, see ParamRamp.
+};
+
+/**
+ * @struct ParamSpec
+ * @brief One row of the parameter table.
+ *
+ * Rows are built from the ID, title and unit, and the modifiers below; a bare
+ * row is an automatable, continuous [0..1] parameter that is not stored.
+ */
+struct ParamSpec {
+  constexpr ParamSpec(ParamID newId, const TChar* newTitle,
+                      const TChar* newUnits = STR16(""))
+      : id(newId), title(newTitle), units(newUnits) {}
+
+  /// Continuous plain range, shown with `decimals` decimals.
+  constexpr ParamSpec linear(double min, double max, int32 decimals) const {
+    ParamSpec spec = *this;
+    spec.minPlain = min;
+    spec.maxPlain = max;
+    spec.precision = decimals;
+    return spec;
+  }
+
+  /// Exponential plain range, `min` must be above 0.
+  constexpr ParamSpec exponential(double min, double max,
+                                  int32 decimals) const {
+    ParamSpec spec = linear(min, max, decimals);
+    spec.taper = ParamTaper::kExponential;
+    return spec;
+  }
+
+  /// Whole numbers from `min` to `max`, one step apart.
+  constexpr ParamSpec steps(int32 min, int32 max) const {
+    ParamSpec spec = linear(min, max, 0);
+    spec.stepCount = max - min;
+    spec.smoothing = ParamSmoothing::kNone;
+    return spec;
+  }
+
+  /// Named entries, the first one at 0.
+  template <int32 kNumStrings>
+  constexpr ParamSpec list(const TChar* const (&names)[kNumStrings]) const {
+    ParamSpec spec = steps(0, kNumStrings - 1);
+    spec.taper = ParamTaper::kList;
+    spec.flags |= ParameterInfo::kIsList;
+    spec.strings = names;
+    return spec;
+  }
+
+  /// Shows a linear gain in dB.
+  constexpr ParamSpec decibels() const {
+    ParamSpec spec = *this;
+    spec.format = ParamFormat::kDecibel;
+    spec.precision = 1;
+    return spec;
+  }
+
+  /// Shows a MIDI note number as a note name.
+  constexpr ParamSpec note() const {
+    ParamSpec spec = *this;
+    spec.format = ParamFormat::kNote;
+    return spec;
+  }
+
+  /// Normalized default value.
+  constexpr ParamSpec byDefault(ParamValue normalized) const {
+    ParamSpec spec = *this;
+    spec.defaultValue = normalized;
+    return spec;
+  }
+
+  /// How the processor applies new values.
+  constexpr ParamSpec smoothed(ParamSmoothing policy) const {
+    ParamSpec spec = *this;
+    spec.smoothing = policy;
+    return spec;
+  }
+
+  /// ParameterInfo flags instead of kCanAutomate.
+  constexpr ParamSpec withFlags(int32 newFlags) const {
+    ParamSpec spec = *this;
+    spec.flags = (flags & ParameterInfo::kIsList) | newFlags;
+    return spec;
+  }
+
+  /// Output parameter written by the processor.
+  constexpr ParamSpec readOnly() const {
+    return withFlags(ParameterInfo::kIsReadOnly)
+        .smoothed(ParamSmoothing::kNone);
+  }
+
+  /// Stored as the normalized value at position `index` of the state.
+  constexpr ParamSpec stored(int32 index) const {
+    ParamSpec spec = *this;
+    spec.stateIndex = index;
+    return spec;
+  }
+
+  /// Stored as the plain value at position `index` of the state.
+  constexpr ParamSpec storedPlain(int32 index) const {
+    ParamSpec spec = stored(index);
+    spec.statePlain = true;
+    return spec;
+  }
+
+  ParamID id;
+  const TChar* title;
+  const TChar* units;
+  double minPlain = 0.;
+  double maxPlain = 1.;
+  ParamValue defaultValue = 0.;  ///< Normalized.
+  int32 stepCount = 0;           ///< 0 for continuous parameters.
+  int32 precision = 2;           ///< Decimals shown.
+  int32 flags = ParameterInfo::kCanAutomate;
+  ParamTaper taper = ParamTaper::kLinear;
+  ParamFormat format = ParamFormat::kNumber;
+  ParamSmoothing smoothing = ParamSmoothing::kBlock;
+  const TChar* const* strings = nullptr;  ///< Entries of a list.
+  int32 stateIndex = -1;    ///< Position in the state, -1 if not stored.
+  bool statePlain = false;  ///< Stored as the plain value.
+};
+
+// Entries of the list parameters, in the order of their enums
+constexpr const TChar* kOffOnNames[] = {STR16("Off"), STR16("On")};
+constexpr const TChar* kWaveNames[] = {STR16("Sine"), STR16("Saw"),
+                                       STR16("Square")};
+constexpr const TChar* kCouplingNames[] = {STR16("Mix"), STR16("PM"),
+                                           STR16("Ring"), STR16("Sync")};
+constexpr const TChar* kLfoShapeNames[] = {STR16("Sine"), STR16("Triangle"),
+                                           STR16("Saw"), STR16("Square")};
+constexpr const TChar* kModSourceNames[] = {
+    STR16("None"), STR16("LFO 1"), STR16("LFO 2"), STR16("Envelope"),
+    STR16("Velocity")};
+constexpr const TChar* kModDestinationNames[] = {
+    STR16("None"), STR16("Pitch"), STR16("Osc 1 Level"), STR16("Osc 2 Level"),
+    STR16("Gain")};
+constexpr const TChar* kMpeZoneNames[] = {STR16("Off"), STR16("Lower"),
+                                          STR16("Upper")};
+
+/// First state position of the modulation matrix slots.
+constexpr int32 kModSlotStateIndex = 15;
+
+/// Source of modulation slot `slot`.
+constexpr ParamSpec modSourceSpec(int32 slot, const TChar* title) {
+  return ParamSpec(modSlotParam(slot, kModSlotSource), title)
+      .list(kModSourceNames)
+      .byDefault(default_ModSource)
+      .stored(kModSlotStateIndex + slot * kModSlotStride + kModSlotSource);
+}
+
+/// Destination of modulation slot `slot`.
+constexpr ParamSpec modDestinationSpec(int32 slot, const TChar* title) {
+  return ParamSpec(modSlotParam(slot, kModSlotDestination), title)
+      .list(kModDestinationNames)
+      .byDefault(default_ModDestination)
+      .stored(kModSlotStateIndex + slot * kModSlotStride +
+              kModSlotDestination);
+}
+
+/// Bipolar amount of modulation slot `slot`.
+constexpr ParamSpec modAmountSpec(int32 slot, const TChar* title) {
+  return ParamSpec(modSlotParam(slot, kModSlotAmount), title, STR16("%"))
+      .linear(-100., 100., 0)
+      .byDefault(default_ModAmount)
+      .stored(kModSlotStateIndex + slot * kModSlotStride + kModSlotAmount);
+}
+
+/**
+ * @brief Every parameter of Laser, in registration order.
+ */
+constexpr ParamSpec kParamTable[] = {
+    // Oscillators
+    ParamSpec(kWaveForm, STR16("WAVE"))
+        .list(kWaveNames)
+        .byDefault(default_WaveType)
+        .storedPlain(0),
+    ParamSpec(kParamGainId, STR16("GAIN"), STR16("dB"))
+        .decibels()
+        .byDefault(default_Gain)
+        .smoothed(ParamSmoothing::kRamp)
+        .stored(1),
+    ParamSpec(kOsc1, STR16("OSC1"), STR16("%"))
+        .linear(0., 100., 0)
+        .byDefault(default_Osc1)
+        .smoothed(ParamSmoothing::kRamp)
+        .stored(2),
+    ParamSpec(kOsc2, STR16("OSC2"), STR16("%"))
+        .linear(0., 100., 0)
+        .byDefault(default_Osc2)
+        .smoothed(ParamSmoothing::kRamp)
+        .stored(3),
+
+    // Oscillator coupling
+    ParamSpec(kOscCoupling, STR16("OSC MODE"))
+        .list(kCouplingNames)
+        .byDefault(default_OscCoupling)
+        .stored(31),
+    ParamSpec(kOscRatio, STR16("OSC2 RATIO"), STR16("x"))
+        .exponential(0.5, 8., 2)
+        .byDefault(default_OscRatio)
+        .stored(32),
+    ParamSpec(kPmDepth, STR16("PM DEPTH"), STR16("%"))
+        .linear(0., 100., 0)
+        .byDefault(default_PmDepth)
+        .smoothed(ParamSmoothing::kRamp)
+        .stored(33),
+
+    // Built-in effects
+    ParamSpec(kDelayMix, STR16("DLY MIX"), STR16("%"))
+        .linear(0., 100., 0)
+        .byDefault(default_DelayMix)
+        .stored(4),
+    ParamSpec(kDelayTime, STR16("DLY TIME"), STR16("ms"))
+        .exponential(StereoDelay::kMinTimeMs, StereoDelay::kMaxTimeMs, 0)
+        .byDefault(default_DelayTime)
+        .stored(5),
+    ParamSpec(kDelayFeedback, STR16("DLY FDBK"), STR16("%"))
+        .linear(0., StereoDelay::kMaxFeedback * 100., 0)
+        .byDefault(default_DelayFeedback)
+        .stored(6),
+    ParamSpec(kDelaySync, STR16("DLY SYNC"))
+        .list(kOffOnNames)
+        .byDefault(default_DelaySync)
+        .stored(7),
+    ParamSpec(kChorusMix, STR16("CHR MIX"), STR16("%"))
+        .linear(0., 100., 0)
+        .byDefault(default_ChorusMix)
+        .stored(8),
+    ParamSpec(kChorusRate, STR16("CHR RATE"), STR16("Hz"))
+        .exponential(Chorus::kMinRateHz, Chorus::kMaxRateHz, 2)
+        .byDefault(default_ChorusRate)
+        .stored(9),
+    ParamSpec(kChorusDepth, STR16("CHR DEPTH"), STR16("ms"))
+        .linear(0., Chorus::kMaxDepthMs, 1)
+        .byDefault(default_ChorusDepth)
+        .stored(10),
+
+    // Modulation LFOs
+    ParamSpec(kLfo1Rate, STR16("LFO1 RATE"), STR16("Hz"))
+        .exponential(Lfo::kMinRateHz, Lfo::kMaxRateHz, 2)
+        .byDefault(default_LfoRate)
+        .stored(11),
+    ParamSpec(kLfo1Shape, STR16("LFO1 SHAPE"))
+        .list(kLfoShapeNames)
+        .byDefault(default_LfoShape)
+        .stored(12),
+    ParamSpec(kLfo2Rate, STR16("LFO2 RATE"), STR16("Hz"))
+        .exponential(Lfo::kMinRateHz, Lfo::kMaxRateHz, 2)
+        .byDefault(default_LfoRate)
+        .stored(13),
+    ParamSpec(kLfo2Shape, STR16("LFO2 SHAPE"))
+        .list(kLfoShapeNames)
+        .byDefault(default_LfoShape)
+        .stored(14),
+
+    // Modulation matrix slots
+    modSourceSpec(0, STR16("MOD1 SRC")),
+    modDestinationSpec(0, STR16("MOD1 DST")),
+    modAmountSpec(0, STR16("MOD1 AMT")),
+    modSourceSpec(1, STR16("MOD2 SRC")),
+    modDestinationSpec(1, STR16("MOD2 DST")),
+    modAmountSpec(1, STR16("MOD2 AMT")),
+    modSourceSpec(2, STR16("MOD3 SRC")),
+    modDestinationSpec(2, STR16("MOD3 DST")),
+    modAmountSpec(2, STR16("MOD3 AMT")),
+    modSourceSpec(3, STR16("MOD4 SRC")),
+    modDestinationSpec(3, STR16("MOD4 DST")),
+    modAmountSpec(3, STR16("MOD4 AMT")),
+
+    // MPE zone
+    ParamSpec(kMpeZone, STR16("MPE ZONE"))
+        .list(kMpeZoneNames)
+        .byDefault(default_MpeZone)
+        .stored(27),
+    ParamSpec(kMpeMemberChannels, STR16("MPE CHANNELS"))
+        .steps(1, kMaxMpeMemberChannels)
+        .byDefault(default_MpeMemberChannels)
+        .stored(28),
+
+    // Voice group split for the aux output buses
+    ParamSpec(kSplitKey, STR16("SPLIT KEY"))
+        .steps(0, 127)
+        .note()
+        .byDefault(default_SplitKey)
+        .stored(29),
+
+    // Quality governor and its diagnostics
+    ParamSpec(kGovernorEnabled, STR16("ADAPTIVE"))
+        .list(kOffOnNames)
+        .byDefault(default_GovernorEnabled)
+        .stored(30),
+    ParamSpec(kGovernorLevel, STR16("QUALITY"))
+        .steps(0, QualityGovernor::kNumLevels - 1)
+        .readOnly(),
+    ParamSpec(kGovernorLoad, STR16("DSP LOAD"), STR16("%"))
+        .linear(0., 200., 0)
+        .readOnly(),
+
+    // Performance controllers, mapped from MIDI by the controller
+    ParamSpec(kSustainPedal, STR16("SUSTAIN")).list(kOffOnNames),
+    ParamSpec(kSostenutoPedal, STR16("SOSTENUTO")).list(kOffOnNames),
+    ParamSpec(kPitchWheel, STR16("PITCH BEND"), STR16("Half Tone"))
+        .linear(-kPitchBendRange, kPitchBendRange, 2)
+        .byDefault(default_PitchWheel)
+        .smoothed(ParamSmoothing::kRamp),
+
+    // The host's own bypass switch, the processor crossfades to silence
+    ParamSpec(kBypass, STR16("Bypass"))
+        .list(kOffOnNames)
+        .byDefault(default_Bypass)
+        .withFlags(ParameterInfo::kCanAutomate | ParameterInfo::kIsBypass)
+        .stored(34),
+
+    // Dumps the last blocks the processor recorded, see flight_recorder.h
+    ParamSpec(kFlightDump, STR16("FLIGHT DUMP"))
+        .list(kOffOnNames)
+        .withFlags(0),
+
+    // Streams every block's inputs to a file, see session_recorder.h
+    ParamSpec(kSessionCapture, STR16("SESSION CAPTURE"))
+        .list(kOffOnNames)
+        .withFlags(0),
+};
+
+/// Number of parameters.
+constexpr int32 kNumParams = sizeof(kParamTable) / sizeof(kParamTable[0]);
+
+/// Parameters every state starts with: waveform, gain and both oscillators.
+constexpr int32 kNumRequiredStateParams = 4;
+
+//-----------------------------------------------------------------------------
+// Compile-time lookups
+//-----------------------------------------------------------------------------
+
+/// One above the highest parameter ID.
+constexpr ParamID kParamIdLimit = [] {
+  ParamID limit = 0;
+  for (const ParamSpec& spec : kParamTable) {
+    limit = std::max(limit, spec.id + 1);
+  }
+  return limit;
+}();
+
+/// Table index of every ID below kParamIdLimit, -1 for unused IDs.
+constexpr std::array<int16, kParamIdLimit> kParamIndices = [] {
+  std::array<int16, kParamIdLimit> indices = {};
+  for (int16& index : indices) {
+    index = -1;
+  }
+  for (int32 i = 0; i < kNumParams; i++) {
+    indices[kParamTable[i].id] = (int16) i;
+  }
+  return indices;
+}();
+
+/// Table index of parameter `id`, -1 if there is no such parameter.
+constexpr int32 paramIndex(ParamID id) {
+  return id < kParamIdLimit ? kParamIndices[id] : -1;
+}
+
+/// Number of parameters stored in the state.
+constexpr int32 kNumStateParams = [] {
+  int32 count = 0;
+  for (const ParamSpec& spec : kParamTable) {
+    count += spec.stateIndex >= 0 ? 1 : 0;
+  }
+  return count;
+}();
+
+/// Table index of every state position, -1 for a position nobody claims.
+constexpr std::array<int16, kNumStateParams> kStateOrder = [] {
+  std::array<int16, kNumStateParams> order = {};
+  for (int16& index : order) {
+    index = -1;
+  }
+  for (int32 i = 0; i < kNumParams; i++) {
+    const int32 position = kParamTable[i].stateIndex;
+    if (position >= 0 && position < kNumStateParams) {
+      order[position] = (int16) i;
+    }
+  }
+  return order;
+}();
+
+/// Number of kRamp parameters.
+constexpr int32 kNumRampParams = [] {
+  int32 count = 0;
+  for (const ParamSpec& spec : kParamTable) {
+    count += spec.smoothing == ParamSmoothing::kRamp ? 1 : 0;
+  }
+  return count;
+}();
+
+/// Index of kRamp parameter `id` among the kRamp parameters, -1 for others.
+constexpr int32 rampIndex(ParamID id) {
+  int32 ramp = 0;
+  for (const ParamSpec& spec : kParamTable) {
+    if (spec.smoothing == ParamSmoothing::kRamp) {
+      if (spec.id == id) {
+        return ramp;
+      }
+      ramp++;
+    }
+  }
+  return -1;
+}
+
+static_assert(
+    [] {
+      for (int32 i = 0; i < kNumParams; i++) {
+        if (paramIndex(kParamTable[i].id) != i) {
+          return false;
+        }
+      }
+      return true;
+    }(),
+    "Parameter IDs must be unique");
+static_assert(
+    [] {
+      for (int16 index : kStateOrder) {
+        if (index < 0) {
+          return false;
+        }
+      }
+      return true;
+    }(),
+    "State positions must be unique and without gaps");
+
+//-----------------------------------------------------------------------------
+// Conversion
+//-----------------------------------------------------------------------------
+
+/// Plain value of `normalized`, snapped to the steps of discrete parameters.
+inline double toPlain(const ParamSpec& spec, ParamValue normalized) {
+  normalized = std::min(std::max(normalized, 0.), 1.);
+  if (spec.taper == ParamTaper::kExponential) {
+    return spec.minPlain * pow(spec.maxPlain / spec.minPlain, normalized);
+  }
+  if (spec.stepCount > 0) {
+    return spec.minPlain + floor(normalized * spec.stepCount + 0.5);
+  }
+  return spec.minPlain + (spec.maxPlain - spec.minPlain) * normalized;
+}
+
+/// Normalized value of `plain`, clamped to the range.
+inline ParamValue toNormalized(const ParamSpec& spec, double plain) {
+  double normalized = 0.;
+  if (spec.taper == ParamTaper::kExponential) {
+    if (plain > 0.) {
+      normalized = log(plain / spec.minPlain) /
+                   log(spec.maxPlain / spec.minPlain);
+    }
+  } else if (spec.maxPlain > spec.minPlain) {
+    normalized = (plain - spec.minPlain) / (spec.maxPlain - spec.minPlain);
+  }
+  normalized = std::min(std::max(normalized, 0.), 1.);
+  if (spec.stepCount > 0) {
+    normalized = floor(normalized * spec.stepCount + 0.5) / spec.stepCount;
+  }
+  return normalized;
+}
+
+/// Step (list entry) of a discrete parameter at `normalized`.
+inline int32 toStep(const ParamSpec& spec, ParamValue normalized) {
+  return (int32) (toPlain(spec, normalized) - spec.minPlain);
+}
+
+/// Value `normalized` takes in the state.
+inline float toStateValue(const ParamSpec& spec, ParamValue normalized) {
+  return (float) (spec.statePlain ? toPlain(spec, normalized) : normalized);
+}
+
+/// Normalized value of a value read from the state.
+inline ParamValue fromStateValue(const ParamSpec& spec, float value) {
+  return spec.statePlain ? toNormalized(spec, value)
+                         : std::min(std::max((ParamValue) value, 0.), 1.);
+}
+
+//-----------------------------------------------------------------------------
+// Smoothing
+//-----------------------------------------------------------------------------
+
+/**
+ * @struct ParamRamp
+ * @brief Value of a kRamp parameter, following its target with a one pole
+ * lowpass advanced once per sub-block.
+ */
+struct ParamRamp {
+  static constexpr float kSnapDistance = 1e-4f;  ///< Ends the ramp.
+
+  float value = 0.f;   ///< Current value, read by the DSP.
+  float target = 0.f;  ///< Last value received.
+
+  /// Moves towards the target by `coefficient` of the remaining distance.
+  void advance(float coefficient) {
+    value += (target - value) * coefficient;
+    if (fabsf(target - value) < kSnapDistance) {
+      value = target;
+    }
+  }
+
+  /// Jumps to the target.
+  void snap() { value = target; }
+};
+
+}  // namespace Radar
+
+#endif  // PARAM_TABLE_H_
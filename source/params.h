@@ -4,17 +4,28 @@
  * @brief Parameter definitions for the Laser VST Plugin.
  *
  * This file defines constants and enumerations for managing the parameters
- * used in the Laser Processor and Controller. Parameters include gain and
- * oscillator frequencies, which can be automated and adjusted dynamically.
+ * used in the Laser Processor and Controller. Parameters include gain,
+ * oscillator frequencies and the built-in effects, which can be automated
+ * and adjusted dynamically.
  *
  * @details
  * The parameters defined here are used to control the behavior of the
  * oscillators and gain processing within the VST plugin. Default values are
  * provided for initialization, and each parameter has a unique ID for
- * identification.
+ * identification. Ranges, units, smoothing and state positions of the IDs
+ * are described by kParamTable in param_table.h.
  *
  * Features:
  * - Parameter IDs for gain and oscillator frequencies.
+ * - Parameter IDs for the delay and chorus effects.
+ * - Parameter IDs for the LFOs and modulation matrix slots.
+ * - Parameter IDs for the MPE zone configuration.
+ * - Parameter IDs and voice groups of the additional output buses.
+ * - Parameter IDs of the quality governor and its diagnostics.
+ * - Parameter IDs of the flight recorder dump and the session capture.
+ * - Parameter IDs of the oscillator coupling (PM, ring modulation, sync).
+ * - Parameter ID of the host bypass.
+ * - Parameter IDs of the MIDI mapped pedals and pitch bend wheel.
  * - Default values for initialization.
  * - Compatible with Steinberg's VST3 parameter handling.
  *
@@ -41,6 +52,27 @@ using namespace Vst;
 #define default_Gain 1.0  ///< Default gain value.
 #define default_Osc1 0.8  ///< Default frequency multiplier for Oscillator 1.
 #define default_Osc2 0.8  ///< Default frequency multiplier for Oscillator 2.
+#define default_DelayMix 0.0       ///< Delay off by default.
+#define default_DelayTime 0.5      ///< Normalized delay time (~141 ms).
+#define default_DelayFeedback 0.4  ///< Normalized delay feedback.
+#define default_DelaySync 0.0      ///< Free running delay by default.
+#define default_ChorusMix 0.0      ///< Chorus off by default.
+#define default_ChorusRate 0.4     ///< Normalized chorus rate (~0.3 Hz).
+#define default_ChorusDepth 0.5    ///< Normalized chorus depth.
+#define default_LfoRate 0.5        ///< Normalized LFO rate (1 Hz).
+#define default_LfoShape 0.0       ///< Sine LFO.
+#define default_ModSource 0.0      ///< Empty modulation slot.
+#define default_ModDestination 0.0 ///< Empty modulation slot.
+#define default_ModAmount 0.5      ///< Bipolar amount, 0.5 is no modulation.
+#define default_MpeZone 0.0        ///< MPE off.
+#define default_MpeMemberChannels 1.0  ///< 15 member channels.
+#define default_SplitKey (60.0 / 127.0)  ///< Split at middle C.
+#define default_GovernorEnabled 1.0  ///< Adaptive quality on.
+#define default_OscCoupling 0.0    ///< Oscillators are only mixed.
+#define default_OscRatio 0.5       ///< Oscillator 2 an octave up.
+#define default_PmDepth 0.25       ///< Half a cycle of phase modulation.
+#define default_Bypass 0.0         ///< Not bypassed.
+#define default_PitchWheel 0.5     ///< Pitch bend wheel centered.
 
 enum WaveType {
   kSine = 0,
@@ -48,6 +80,92 @@ enum WaveType {
   kSquare
 };
 
+/**
+ * @enum LfoShape
+ * @brief Waveforms of the modulation LFOs.
+ */
+enum LfoShape {
+  kLfoSine = 0,
+  kLfoTriangle,
+  kLfoSaw,
+  kLfoSquare,
+  kNumLfoShapes
+};
+
+/**
+ * @enum ModSource
+ * @brief Sources selectable in a modulation matrix slot.
+ */
+enum ModSource {
+  kModSourceNone = 0,
+  kModSourceLfo1,      ///< LFO 1, bipolar.
+  kModSourceLfo2,      ///< LFO 2, bipolar.
+  kModSourceEnvelope,  ///< Amplitude envelope of the voice, unipolar.
+  kModSourceVelocity,  ///< NoteOn velocity of the voice, unipolar.
+  kNumModSources
+};
+
+/**
+ * @enum ModDestination
+ * @brief Destinations selectable in a modulation matrix slot.
+ */
+enum ModDestination {
+  kModDestNone = 0,
+  kModDestPitch,      ///< Pitch of both oscillators, +-1 octave.
+  kModDestOsc1Level,  ///< Level of Oscillator 1.
+  kModDestOsc2Level,  ///< Level of Oscillator 2.
+  kModDestGain,       ///< Voice gain.
+  kNumModDestinations
+};
+
+/**
+ * @enum MpeLayout
+ * @brief MIDI Polyphonic Expression zone layouts.
+ */
+enum MpeLayout {
+  kMpeOff = 0,    ///< Channels are ignored, notes are matched by pitch.
+  kMpeLowerZone,  ///< Master channel 1, member channels from 2 upwards.
+  kMpeUpperZone,  ///< Master channel 16, member channels from 15 downwards.
+  kNumMpeLayouts
+};
+
+/**
+ * @enum OscCoupling
+ * @brief How Oscillator 1 drives Oscillator 2.
+ */
+enum OscCoupling {
+  kCouplingMix = 0,  ///< Independent, only summed.
+  kCouplingPm,       ///< Oscillator 1 modulates the phase of Oscillator 2.
+  kCouplingRing,     ///< Oscillator 2 is multiplied by Oscillator 1.
+  kCouplingSync,     ///< Oscillator 1 restarts Oscillator 2 (hard sync).
+  kNumOscCouplings
+};
+
+/**
+ * @enum VoiceGroup
+ * @brief Groups of voices that can be routed to an output bus of their own.
+ *
+ * Group n renders to output bus kFirstGroupBus + n while that bus is active,
+ * and into the main mix otherwise.
+ */
+enum VoiceGroup {
+  kVoiceGroupLow = 0,  ///< Notes below the split key.
+  kVoiceGroupHigh,     ///< Notes from the split key upwards.
+  kNumVoiceGroups
+};
+
+/// Index of the output bus of the first voice group, after the main bus.
+constexpr int32 kFirstGroupBus = 1;
+
+/// Maximum number of member channels of an MPE zone.
+constexpr int32 kMaxMpeMemberChannels = 15;
+
+/// Pitch bend range of the wheel in semitones, up and down.
+constexpr int32 kPitchBendRange = 2;
+
+/// Number of slots in the modulation matrix.
+constexpr int32 kNumModSlots = 4;
+
 enum WaveParams : ParamID {
   kWaveForm = 100
 };
@@ -69,4 +187,134 @@ enum GainParams : ParamID {
   kParamGainId = 300  ///< Parameter ID for gain control.
 };
 
+/**
+ * @enum DelayParams
+ * @brief Parameter IDs for the built-in stereo delay.
+ */
+enum DelayParams : ParamID {
+  kDelayMix = 400,  ///< Wet level, 0 bypasses the delay.
+  kDelayTime,       ///< Delay time, or note division when synced.
+  kDelayFeedback,   ///< Feedback amount.
+  kDelaySync        ///< Tempo sync on/off.
+};
+
+/**
+ * @enum ChorusParams
+ * @brief Parameter IDs for the built-in chorus.
+ */
+enum ChorusParams : ParamID {
+  kChorusMix = 500,  ///< Wet level, 0 bypasses the chorus.
+  kChorusRate,       ///< LFO rate.
+  kChorusDepth       ///< Sweep depth.
+};
+
+/**
+ * @enum LfoParams
+ * @brief Parameter IDs for the modulation LFOs.
+ */
+enum LfoParams : ParamID {
+  kLfo1Rate = 600,  ///< LFO 1 rate.
+  kLfo1Shape,       ///< LFO 1 waveform.
+  kLfo2Rate,        ///< LFO 2 rate.
+  kLfo2Shape        ///< LFO 2 waveform.
+};
+
+/**
+ * @enum ModSlotField
+ * @brief Parameters of one modulation matrix slot.
+ */
+enum ModSlotField : ParamID {
+  kModSlotSource = 0,   ///< Source (ModSource).
+  kModSlotDestination,  ///< Destination (ModDestination).
+  kModSlotAmount,       ///< Bipolar amount.
+  kModSlotStride        ///< Number of parameters per slot.
+};
+
+/**
+ * @enum ModMatrixParams
+ * @brief Parameter IDs for the modulation matrix slots.
+ *
+ * Slot n (0-based) owns the IDs kModSlotFirst + n * kModSlotStride + field.
+ */
+enum ModMatrixParams : ParamID {
+  kModSlotFirst = 700,  ///< Source of the first slot.
+  kModSlotLast = kModSlotFirst + kNumModSlots * kModSlotStride - 1
+};
+
+/**
+ * @enum MpeParams
+ * @brief Parameter IDs for the MPE zone configuration.
+ */
+enum MpeParams : ParamID {
+  kMpeZone = 800,     ///< Zone layout (MpeLayout).
+  kMpeMemberChannels  ///< Member channels of the zone, 1..15.
+};
+
+/**
+ * @enum OutputParams
+ * @brief Parameter IDs for the routing of voice groups to output buses.
+ */
+enum OutputParams : ParamID {
+  kSplitKey = 900  ///< Lowest MIDI note of the high voice group, 0..127.
+};
+
+/**
+ * @enum GovernorParams
+ * @brief Parameter IDs of the quality governor.
+ *
+ * The level and load are read-only output parameters written by the
+ * processor, for diagnostics.
+ */
+enum GovernorParams : ParamID {
+  kGovernorEnabled = 1000,  ///< Adaptive quality on/off.
+  kGovernorLevel,           ///< Current quality level, 0 is full quality.
+  kGovernorLoad             ///< Smoothed DSP load, 1 is 200 % of the budget.
+};
+
+/**
+ * @enum OscParams
+ * @brief Parameter IDs of the oscillator coupling.
+ */
+enum OscParams : ParamID {
+  kOscCoupling = 1200,  ///< OscCoupling mode.
+  kOscRatio,            ///< Oscillator 2 frequency ratio, 0.5..8.
+  kPmDepth              ///< Phase modulation depth, up to two cycles.
+};
+
+/**
+ * @enum BypassParams
+ * @brief Parameter ID of the bypass, flagged kIsBypass for the host.
+ */
+enum BypassParams : ParamID {
+  kBypass = 1300  ///< Crossfades the output to silence when on.
+};
+
+/**
+ * @enum MidiParams
+ * @brief Parameter IDs the controller maps MIDI controllers to.
+ *
+ * They follow the performance rather than the preset and are not stored.
+ */
+enum MidiParams : ParamID {
+  kSustainPedal = 1400,  ///< CC64, holds notes after their NoteOff.
+  kSostenutoPedal,       ///< CC66, holds the notes down when it is pressed.
+  kPitchWheel            ///< Pitch bend of every note, 0.5 is centered.
+};
+
+/**
+ * @enum FlightParams
+ * @brief Parameter IDs of the flight recorder and the session capture.
+ */
+enum FlightParams : ParamID {
+  kFlightDump = 1100,  ///< Dumps the recorder when switched on.
+  kSessionCapture      ///< Streams the host inputs to a file while on.
+};
+
+/**
+ * @brief Returns the parameter ID of `field` in modulation slot `slot`.
+ */
+constexpr ParamID modSlotParam(int32 slot, ModSlotField field) {
+  return kModSlotFirst + slot * kModSlotStride + field;
+}
+
 #endif  // PARAMS_H_
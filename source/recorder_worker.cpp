@@ -0,0 +1,102 @@
+/**
+ * @file recorder_worker.cpp
+ *
+ * @brief Implementation of the background thread shared by the recorders of
+ * the Laser VST Plugin.
+ *
+ * This file implements the RecorderWorker class declared in
+ * recorder_worker.h.
+ *
+ * @details
+ * Two locks: `lifecycle` serializes add() and remove() including the start
+ * and the join of the thread, `mutex` guards the task list and is held by
+ * the thread while it polls. The shared state is created on first use and
+ * never destroyed, so no static destructor ever runs against a thread.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "recorder_worker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Radar {
+
+namespace {
+
+struct WorkerState {
+  std::mutex lifecycle;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::vector<RecorderTask*> tasks;
+  std::thread thread;
+};
+
+WorkerState& getState() {
+  static WorkerState* state = new WorkerState;
+  return *state;
+}
+
+//-----------------------------------------------------------------------------
+// Body of the thread, ends once the last task was removed
+void run() {
+  WorkerState& state = getState();
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (!state.tasks.empty()) {
+    bool busy = false;
+    for (RecorderTask* task : state.tasks) {
+      busy |= task->poll();
+    }
+    state.wakeup.wait_for(
+        lock, std::chrono::milliseconds(busy ? RecorderWorker::kBusyInterval
+                                             : RecorderWorker::kIdleInterval));
+  }
+}
+
+}  // namespace
+
+//-----------------------------------------------------------------------------
+void RecorderWorker::add(RecorderTask* task) {
+  WorkerState& state = getState();
+  std::lock_guard<std::mutex> lifecycle(state.lifecycle);
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.tasks.push_back(task);
+  }
+  if (!state.thread.joinable()) {
+    state.thread = std::thread(run);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void RecorderWorker::remove(RecorderTask* task) {
+  WorkerState& state = getState();
+  std::lock_guard<std::mutex> lifecycle(state.lifecycle);
+  bool last = false;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.tasks.erase(
+        std::remove(state.tasks.begin(), state.tasks.end(), task),
+        state.tasks.end());
+    last = state.tasks.empty();
+  }
+  if (last && state.thread.joinable()) {
+    state.wakeup.notify_all();
+    state.thread.join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+}  // namespace Radar
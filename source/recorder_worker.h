@@ -0,0 +1,84 @@
+/**
+ * @file recorder_worker.h
+ *
+ * @brief Background thread shared by the recorders of every Laser instance.
+ *
+ * This file defines the RecorderTask interface and the RecorderWorker, the
+ * one thread of the process that writes flight dumps and session captures
+ * for all active processors.
+ *
+ * @details
+ * The audio thread never wakes the worker: it only sets atomics that the
+ * worker polls. While any task has work the worker polls every
+ * kBusyInterval, otherwise every kIdleInterval, so a host running hundreds
+ * of idle instances still sees a single thread waking a few times a second.
+ *
+ * The thread starts with the first task added and ends with the last one
+ * removed, so nothing runs while no processor is active and no thread is
+ * left behind when the module unloads. Tasks are polled under a lock that
+ * remove() takes too: once remove() returned the task is never polled
+ * again and can be destroyed.
+ *
+ * Features:
+ * - One thread per process instead of one per recorder and instance.
+ * - Sparse polling while idle.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef RECORDER_WORKER_H_
+#define RECORDER_WORKER_H_
+
+#include "pluginterfaces/vst/vsttypes.h"
+
+using namespace Steinberg;
+
+namespace Radar {
+
+/**
+ * @class RecorderTask
+ * @brief Work the RecorderWorker polls.
+ */
+class RecorderTask {
+ public:
+  virtual ~RecorderTask() = default;
+
+  /**
+   * @brief Does whatever work is pending, on the worker thread.
+   *
+   * @return true while more work is expected soon, so the worker polls at
+   * its busy rate.
+   */
+  virtual bool poll() = 0;
+};
+
+/**
+ * @class RecorderWorker
+ * @brief The thread shared by every RecorderTask of the process.
+ */
+class RecorderWorker {
+ public:
+  static constexpr int32 kBusyInterval = 5;    ///< Poll period, ms.
+  static constexpr int32 kIdleInterval = 100;  ///< Without work, ms.
+
+  /// Starts polling `task`, starting the thread if it is the first one.
+  static void add(RecorderTask* task);
+
+  /**
+   * @brief Stops polling `task`, ending the thread if it was the last one.
+   *
+   * Waits for a poll of `task` in progress. Never call it from poll().
+   */
+  static void remove(RecorderTask* task);
+};
+
+}  // namespace Radar
+
+#endif  // RECORDER_WORKER_H_
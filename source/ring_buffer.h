@@ -0,0 +1,115 @@
+/**
+ * @file ring_buffer.h
+ *
+ * @brief Power-of-two ring buffer used by the delay based effects of the
+ * Laser VST Plugin.
+ *
+ * This file defines the RingBuffer class, a circular sample buffer whose
+ * memory is carved from the processor's Arena.
+ *
+ * @details
+ * The capacity is always rounded up to a power of two, so wrapping an index
+ * is a single AND with the mask instead of a compare-and-branch. For block
+ * processing the buffer exposes how many samples can be read or written from
+ * a position before the end of the memory is reached; effects split their
+ * blocks at those points and run plain loops over contiguous memory, which
+ * the compiler turns into SIMD code.
+ *
+ * Features:
+ * - Mask-based index wrap.
+ * - Contiguous-run helpers for vectorizable block processing.
+ * - Linear interpolated fractional reads.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <cmath>
+
+#include "arena.h"
+
+#include "pluginterfaces/vst/vsttypes.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/**
+ * @brief Returns the smallest power of two greater or equal to `value`.
+ */
+inline int32 nextPowerOfTwo(int32 value) {
+  int32 result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+/**
+ * @class RingBuffer
+ * @brief Circular buffer of samples with a power-of-two capacity.
+ */
+class RingBuffer {
+ public:
+  /**
+   * @brief Carves room for at least `minSize` samples from `arena`.
+   */
+  void carve(Arena& arena, int32 minSize) {
+    buffer = arena.carve<Sample32>(nextPowerOfTwo(minSize));
+    mask = buffer.size - 1;
+    writeIndex = 0;
+  }
+
+  /// Zeroes the content and rewinds the write position.
+  void clear() {
+    buffer.clear();
+    writeIndex = 0;
+  }
+
+  int32 size() const { return buffer.size; }
+  int32 wrap(int32 index) const { return index & mask; }
+
+  /// Position of the next sample to be written.
+  int32 getWriteIndex() const { return writeIndex; }
+
+  /// Number of samples from `index` to the end of the memory.
+  int32 contiguous(int32 index) const { return buffer.size - index; }
+
+  /// Pointer to the sample at the already wrapped `index`.
+  Sample32* at(int32 index) const { return buffer.data + index; }
+
+  /// Moves the write position forward by `numSamples`.
+  void advance(int32 numSamples) { writeIndex = wrap(writeIndex + numSamples); }
+
+  /**
+   * @brief Reads `delay` samples behind the position `writeIndex + offset`,
+   * interpolating linearly between neighbouring samples.
+   */
+  Sample32 readFractional(int32 offset, float delay) const {
+    float position = (float) (writeIndex + offset) - delay;
+    int32 index = (int32) floorf(position);
+    float fraction = position - (float) index;
+    Sample32 a = buffer.data[wrap(index)];
+    Sample32 b = buffer.data[wrap(index + 1)];
+    return a + (b - a) * fraction;
+  }
+
+ private:
+  Span<Sample32> buffer;
+  int32 mask = 0;
+  int32 writeIndex = 0;
+};
+
+}  // namespace Radar
+
+#endif  // RING_BUFFER_H_
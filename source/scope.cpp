@@ -0,0 +1,116 @@
+/**
+ * @file scope.cpp
+ *
+ * @brief Implementation of the output capture for the oscilloscope and
+ * spectrum view of the Laser VST Plugin.
+ *
+ * This file implements the ScopeCapture and ScopeHistory classes declared
+ * in scope.h.
+ *
+ * @details
+ * ScopeCapture keeps the block it is filling between process() calls, so
+ * the data exchange queue is only touched once per kMaxFrames captured
+ * samples.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "scope.h"
+
+#include <algorithm>
+
+namespace Radar {
+
+//-----------------------------------------------------------------------------
+// ScopeCapture
+//-----------------------------------------------------------------------------
+bool ScopeCapture::configure(DataExchangeHandler::Config& config,
+                             const ProcessSetup& /*setup*/) {
+  config.blockSize = sizeof(ScopeBlock);
+  config.numBlocks = kNumBlocks;
+  config.alignment = 32;
+  config.userContextID = 0;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void ScopeCapture::setup(SampleRate sampleRate) {
+  decimation = std::max(1, (int32) (sampleRate / kTargetRate + 0.5));
+  rate = (float) (sampleRate / decimation);
+  scale = 0.5f / (float) decimation;
+  block = nullptr;
+  count = 0;
+  accumulator = 0.f;
+}
+
+//-----------------------------------------------------------------------------
+void ScopeCapture::process(const Sample32* left, const Sample32* right,
+                           int32 numSamples, DataExchangeHandler& exchange) {
+  for (int32 i = 0; i < numSamples; i++) {
+    accumulator += left[i] + right[i];
+    if (++count < decimation) {
+      continue;
+    }
+    float sample = accumulator * scale;
+    count = 0;
+    accumulator = 0.f;
+
+    if (!block) {
+      // No free block means the UI is behind, drop rather than wait
+      DataExchangeBlock next = exchange.getCurrentOrNewBlock();
+      if (!next.data) {
+        continue;
+      }
+      block = static_cast<ScopeBlock*>(next.data);
+      block->sampleRate = rate;
+      block->numFrames = 0;
+    }
+
+    block->samples[block->numFrames++] = sample;
+    if (block->numFrames == ScopeBlock::kMaxFrames) {
+      exchange.sendCurrentBlock();
+      block = nullptr;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ScopeCapture::stop(DataExchangeHandler& exchange) {
+  if (block) {
+    exchange.discardCurrentBlock();
+    block = nullptr;
+  }
+  count = 0;
+  accumulator = 0.f;
+}
+
+//-----------------------------------------------------------------------------
+// ScopeHistory
+//-----------------------------------------------------------------------------
+void ScopeHistory::write(const ScopeBlock& block) {
+  uint32 numFrames = std::min(block.numFrames, ScopeBlock::kMaxFrames);
+  for (uint32 i = 0; i < numFrames; i++) {
+    samples[(writeCount + i) & (kSize - 1)] = block.samples[i];
+  }
+  writeCount += numFrames;
+  sampleRate = block.sampleRate;
+}
+
+//-----------------------------------------------------------------------------
+void ScopeHistory::read(float* destination, uint32 numSamples) const {
+  numSamples = std::min(numSamples, kSize);
+  uint64 start = writeCount - numSamples;
+  for (uint32 i = 0; i < numSamples; i++) {
+    destination[i] = samples[(start + i) & (kSize - 1)];
+  }
+}
+
+//-----------------------------------------------------------------------------
+}  // namespace Radar
@@ -0,0 +1,133 @@
+/**
+ * @file scope.h
+ *
+ * @brief Output capture for the oscilloscope and spectrum view of the Laser
+ * VST Plugin.
+ *
+ * This file defines the block format shared by processor and controller,
+ * the ScopeCapture class, which decimates the processor output into data
+ * exchange blocks on the audio thread, and the ScopeHistory class, which
+ * keeps the received samples on the UI thread for the ScopeView.
+ *
+ * @details
+ * Blocks travel through the SDK's DataExchangeHandler: the audio thread only
+ * fills a block it got from a preallocated, wait-free queue and hands it
+ * back, it never locks, allocates or waits. When no block is free (the UI is
+ * lagging behind) samples are dropped instead. Per sample the capture costs
+ * one add and one compare; the stored stream is the mono sum, decimated to
+ * about kTargetRate by averaging.
+ *
+ * Capturing is switched on by the controller with a kScopeEnableMessageID
+ * message while an editor is open, so nothing is captured or sent while the
+ * editor is closed.
+ *
+ * Features:
+ * - Decimated mono capture of the plug-in output.
+ * - Wait-free hand-off from the audio thread.
+ * - UI side sample history with the newest samples always available.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef SCOPE_H_
+#define SCOPE_H_
+
+#include "pluginterfaces/vst/vsttypes.h"
+#include "public.sdk/source/vst/utility/dataexchange.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/// Message sent by the controller to switch the capture on and off.
+constexpr auto kScopeEnableMessageID = "ScopeEnable";
+
+/// Integer attribute of kScopeEnableMessageID, 1 to capture, 0 to stop.
+constexpr auto kScopeEnabledAttribute = "Enabled";
+
+/**
+ * @struct ScopeBlock
+ * @brief Layout of one data exchange block of captured samples.
+ */
+struct ScopeBlock {
+  static constexpr uint32 kMaxFrames = 1024;  ///< Samples per block.
+
+  float sampleRate = 0.f;  ///< Rate of the decimated stream in Hz.
+  uint32 numFrames = 0;    ///< Valid entries in `samples`.
+  float samples[kMaxFrames];
+};
+
+/**
+ * @class ScopeCapture
+ * @brief Decimates the output on the audio thread into ScopeBlocks.
+ */
+class ScopeCapture {
+ public:
+  static constexpr float kTargetRate = 24000.f;  ///< Decimated rate in Hz.
+  static constexpr uint32 kNumBlocks = 8;        ///< Blocks in flight.
+
+  /// Data exchange queue configuration for the current ProcessSetup.
+  static bool configure(DataExchangeHandler::Config& config,
+                        const ProcessSetup& setup);
+
+  /// Computes the decimation for `sampleRate`, drops any partial block.
+  void setup(SampleRate sampleRate);
+
+  /// Captures `numSamples` of stereo output.
+  void process(const Sample32* left, const Sample32* right,
+               int32 numSamples, DataExchangeHandler& exchange);
+
+  /// Drops the partially filled block, if any.
+  void stop(DataExchangeHandler& exchange);
+
+  /// Whether a block is currently being filled.
+  bool isCapturing() const { return block != nullptr; }
+
+ private:
+  ScopeBlock* block = nullptr;  ///< Block being filled, owned by the queue.
+  int32 decimation = 1;         ///< Input samples per captured sample.
+  int32 count = 0;              ///< Input samples in `accumulator`.
+  float accumulator = 0.f;      ///< Sum of the current decimation window.
+  float scale = 0.5f;           ///< Turns the sum into a mono average.
+  float rate = kTargetRate;     ///< Decimated rate in Hz.
+};
+
+/**
+ * @class ScopeHistory
+ * @brief The most recent captured samples, owned by the controller.
+ *
+ * Written and read on the UI thread only.
+ */
+class ScopeHistory {
+ public:
+  static constexpr uint32 kSize = 8192;  ///< Capacity, a power of two.
+
+  /// Appends the samples of a received block.
+  void write(const ScopeBlock& block);
+
+  /// Copies the newest `numSamples` samples, oldest first.
+  void read(float* destination, uint32 numSamples) const;
+
+  /// Total number of samples written so far, to detect new data.
+  uint64 getWriteCount() const { return writeCount; }
+
+  /// Rate of the stored samples in Hz.
+  float getSampleRate() const { return sampleRate; }
+
+ private:
+  float samples[kSize] = {};
+  uint64 writeCount = 0;
+  float sampleRate = ScopeCapture::kTargetRate;
+};
+
+}  // namespace Radar
+
+#endif  // SCOPE_H_
@@ -0,0 +1,218 @@
+/**
+ * @file scope_view.cpp
+ *
+ * @brief Implementation of the oscilloscope and spectrum view of the Laser
+ * VST Plugin editor.
+ *
+ * This file implements the ScopeView class declared in scope_view.h.
+ *
+ * @details
+ * All work happens on the UI thread. The FFT is an in-place iterative
+ * radix-2 transform over preallocated buffers, so drawing a frame does not
+ * allocate apart from the graphics paths.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - VSTGUI
+ * - Standard Math Library (math.h)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "scope_view.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "vstgui/lib/cdrawcontext.h"
+#include "vstgui/lib/cgraphicspath.h"
+
+namespace Radar {
+
+using namespace VSTGUI;
+
+static const float kTwoPi = 6.28318530718f;
+
+static const CColor kScopeBackground(16, 16, 20, 255);
+static const CColor kScopeGrid(60, 60, 70, 255);
+static const CColor kScopeWave(80, 200, 255, 255);
+static const CColor kScopeSpectrum(255, 120, 60, 255);
+
+/**
+ * @brief In-place radix-2 FFT, `data.size()` must be a power of two.
+ */
+static void fft(std::vector<std::complex<float>>& data) {
+  const size_t n = data.size();
+
+  // Bit reversal permutation
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(data[i], data[j]);
+    }
+  }
+
+  for (size_t length = 2; length <= n; length <<= 1) {
+    const std::complex<float> step =
+        std::polar(1.f, -kTwoPi / (float) length);
+    for (size_t start = 0; start < n; start += length) {
+      std::complex<float> twiddle(1.f, 0.f);
+      for (size_t k = 0; k < length / 2; k++) {
+        std::complex<float> even = data[start + k];
+        std::complex<float> odd = data[start + k + length / 2] * twiddle;
+        data[start + k] = even + odd;
+        data[start + k + length / 2] = even - odd;
+        twiddle *= step;
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// ScopeView
+//-----------------------------------------------------------------------------
+ScopeView::ScopeView(const CRect& size, const ScopeHistory& history)
+    : CView(size),
+      history(history),
+      samples(kFftSize),
+      window(kFftSize),
+      spectrum(kFftSize) {
+  for (uint32 i = 0; i < kFftSize; i++) {
+    window[i] = 0.5f - 0.5f * cosf(kTwoPi * (float) i / (float) kFftSize);
+  }
+  setMouseEnabled(false);
+}
+
+//-----------------------------------------------------------------------------
+bool ScopeView::attached(CView* parent) {
+  if (!CView::attached(parent)) {
+    return false;
+  }
+  timer = makeOwned<CVSTGUITimer>([this](CVSTGUITimer*) { onTimer(); },
+                                  1000 / kFrameRate);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ScopeView::removed(CView* parent) {
+  timer = nullptr;
+  return CView::removed(parent);
+}
+
+//-----------------------------------------------------------------------------
+void ScopeView::onTimer() {
+  if (history.getWriteCount() != drawnWriteCount) {
+    invalid();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ScopeView::draw(CDrawContext* context) {
+  drawnWriteCount = history.getWriteCount();
+  history.read(samples.data(), kFftSize);
+
+  const CRect& size = getViewSize();
+  context->setDrawMode(kAntiAliasing);
+  context->setFillColor(kScopeBackground);
+  context->drawRect(size, kDrawFilled);
+
+  CRect upper = size;
+  upper.bottom = size.top + size.getHeight() / 2.;
+  CRect lower = size;
+  lower.top = upper.bottom;
+
+  drawWaveform(context, upper);
+  drawSpectrum(context, lower);
+
+  setDirty(false);
+}
+
+//-----------------------------------------------------------------------------
+void ScopeView::drawWaveform(CDrawContext* context, const CRect& r) {
+  const CCoord centre = r.top + r.getHeight() / 2.;
+
+  context->setLineWidth(1.);
+  context->setFrameColor(kScopeGrid);
+  context->drawLine(CPoint(r.left, centre), CPoint(r.right, centre));
+
+  // Trigger on the last rising zero crossing that leaves a full window
+  uint32 start = kFftSize - kScopeSamples;
+  for (uint32 i = kFftSize - kScopeSamples; i > 1; i--) {
+    if (samples[i - 1] < 0.f && samples[i] >= 0.f) {
+      start = i;
+      break;
+    }
+  }
+  start = std::min(start, kFftSize - kScopeSamples);
+
+  auto path = VSTGUI::owned(context->createGraphicsPath());
+  if (!path) {
+    return;
+  }
+  const CCoord xStep = r.getWidth() / (CCoord) (kScopeSamples - 1);
+  const CCoord yScale = r.getHeight() / 2.;
+  for (uint32 i = 0; i < kScopeSamples; i++) {
+    float value = std::max(-1.f, std::min(1.f, samples[start + i]));
+    CPoint point(r.left + xStep * i, centre - yScale * value);
+    if (i == 0) {
+      path->beginSubpath(point);
+    } else {
+      path->addLine(point);
+    }
+  }
+
+  context->setFrameColor(kScopeWave);
+  context->drawGraphicsPath(path, CDrawContext::kPathStroked);
+}
+
+//-----------------------------------------------------------------------------
+void ScopeView::drawSpectrum(CDrawContext* context, const CRect& r) {
+  for (uint32 i = 0; i < kFftSize; i++) {
+    spectrum[i] = std::complex<float>(samples[i] * window[i], 0.f);
+  }
+  fft(spectrum);
+
+  // Log frequency axis from 20 Hz to the Nyquist frequency of the capture
+  const float nyquist = history.getSampleRate() * 0.5f;
+  const float minHz = 20.f;
+  const float logRange = logf(nyquist / minHz);
+  const float binHz = history.getSampleRate() / (float) kFftSize;
+
+  // Hann window coherent gain is 0.5, so a full scale sine reads 0 dB
+  const float normalize = 4.f / (float) kFftSize;
+
+  auto path = VSTGUI::owned(context->createGraphicsPath());
+  if (!path) {
+    return;
+  }
+  const int32 width = std::max(2, (int32) r.getWidth());
+  for (int32 x = 0; x < width; x++) {
+    float hz = minHz * expf(logRange * (float) x / (float) (width - 1));
+    uint32 bin = std::min((uint32) (hz / binHz + 0.5f), kFftSize / 2 - 1);
+    float magnitude = std::abs(spectrum[bin]) * normalize;
+    float db = 20.f * log10f(std::max(magnitude, 1e-9f));
+    float y = std::max(0.f, std::min(1.f, db / kMinDecibels));
+
+    CPoint point(r.left + x, r.top + r.getHeight() * y);
+    if (x == 0) {
+      path->beginSubpath(point);
+    } else {
+      path->addLine(point);
+    }
+  }
+
+  context->setLineWidth(1.);
+  context->setFrameColor(kScopeSpectrum);
+  context->drawGraphicsPath(path, CDrawContext::kPathStroked);
+}
+
+//-----------------------------------------------------------------------------
+}  // namespace Radar
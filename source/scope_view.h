@@ -0,0 +1,83 @@
+/**
+ * @file scope_view.h
+ *
+ * @brief Declaration of the oscilloscope and spectrum view of the Laser VST
+ * Plugin editor.
+ *
+ * This file defines the ScopeView class, a VSTGUI view that shows the
+ * newest captured output samples as a waveform and as a spectrum.
+ *
+ * @details
+ * The view redraws from a timer capped at kFrameRate and only when new
+ * samples arrived since the last frame. The spectrum is computed while
+ * drawing, on the UI thread: a Hann windowed kFftSize point FFT, shown on a
+ * logarithmic frequency axis. The waveform is aligned on a rising zero
+ * crossing so periodic signals stand still.
+ *
+ * Features:
+ * - Triggered oscilloscope.
+ * - Log-frequency spectrum analyzer in dB.
+ * - Frame rate capped redraws, idle while no audio arrives.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - VSTGUI
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef SCOPE_VIEW_H_
+#define SCOPE_VIEW_H_
+
+#include <complex>
+#include <vector>
+
+#include "scope.h"
+
+#include "vstgui/lib/cview.h"
+#include "vstgui/lib/cvstguitimer.h"
+
+namespace Radar {
+
+/**
+ * @class ScopeView
+ * @brief Oscilloscope (upper half) and spectrum analyzer (lower half).
+ */
+class ScopeView : public VSTGUI::CView {
+ public:
+  static constexpr uint32 kFrameRate = 30;        ///< Maximum redraws/s.
+  static constexpr uint32 kFftSize = 2048;        ///< Spectrum resolution.
+  static constexpr uint32 kScopeSamples = 512;    ///< Waveform length.
+  static constexpr float kMinDecibels = -90.f;    ///< Spectrum floor.
+
+  ScopeView(const VSTGUI::CRect& size, const ScopeHistory& history);
+
+  // CView overrides
+  void draw(VSTGUI::CDrawContext* context) override;
+  bool attached(VSTGUI::CView* parent) override;
+  bool removed(VSTGUI::CView* parent) override;
+
+ protected:
+  /// Invalidates the view if new samples arrived since the last frame.
+  void onTimer();
+
+  void drawWaveform(VSTGUI::CDrawContext* context, const VSTGUI::CRect& r);
+  void drawSpectrum(VSTGUI::CDrawContext* context, const VSTGUI::CRect& r);
+
+  const ScopeHistory& history;  ///< Owned by the controller.
+  uint64 drawnWriteCount = 0;   ///< History position of the last frame.
+  VSTGUI::SharedPointer<VSTGUI::CVSTGUITimer> timer;
+
+  // Scratch buffers, allocated once with the view
+  std::vector<float> samples;                 ///< kFftSize newest samples.
+  std::vector<float> window;                  ///< Hann window.
+  std::vector<std::complex<float>> spectrum;  ///< FFT in/out.
+};
+
+}  // namespace Radar
+
+#endif  // SCOPE_VIEW_H_
@@ -0,0 +1,315 @@
+/**
+ * @file session_recorder.cpp
+ *
+ * @brief Implementation of the streaming input capture of the Laser VST
+ * Plugin.
+ *
+ * This file implements the SessionRecorder class declared in
+ * session_recorder.h.
+ *
+ * @details
+ * Queue protocol: `written` and `consumed` count the bytes that ever went
+ * through the queue, so their difference is its fill and neither wraps in
+ * practice. The audio thread puts a whole record behind `written` and only
+ * then publishes it with a release store; the worker thread reads records
+ * up to an acquired `written` and hands the room back with a release store
+ * of `consumed`. The worker thread therefore never sees half a record.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "session_recorder.h"
+#include "flight_recorder.h"
+
+#include <filesystem>
+#include <new>
+
+namespace Radar {
+
+//-----------------------------------------------------------------------------
+// Event payloads behind pointers are not captured, the pointers would dangle
+static void clearEventPointers(Event& event) {
+  switch (event.type) {
+    case Event::kDataEvent:
+      event.data.size = 0;
+      event.data.bytes = nullptr;
+      break;
+
+    case Event::kNoteExpressionTextEvent:
+      event.noteExpressionText.textLen = 0;
+      event.noteExpressionText.text = nullptr;
+      break;
+
+    case Event::kChordEvent:
+      event.chord.textLen = 0;
+      event.chord.text = nullptr;
+      break;
+
+    case Event::kScaleEvent:
+      event.scale.textLen = 0;
+      event.scale.text = nullptr;
+      break;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// SessionRecorder
+//-----------------------------------------------------------------------------
+void SessionRecorder::start() {
+  stop();
+
+  cursor = 0;
+  droppedBlocks = 0;
+  capturing = false;
+  written.store(0, std::memory_order_relaxed);
+  consumed.store(0, std::memory_order_relaxed);
+
+  RecorderWorker::add(this);
+  started = true;
+}
+
+//-----------------------------------------------------------------------------
+void SessionRecorder::stop() {
+  if (started) {
+    RecorderWorker::remove(this);
+    started = false;
+
+    // The audio thread has stopped, write what it queued last
+    drain();
+  }
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+  capturing = false;
+
+  delete[] storage.exchange(nullptr, std::memory_order_relaxed);
+  queue = nullptr;
+  requested.store(false, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+bool SessionRecorder::poll() {
+  // Allocated here, never on the audio thread, and only once asked for
+  if (requested.load(std::memory_order_relaxed) &&
+      !storage.load(std::memory_order_relaxed)) {
+    storage.store(new (std::nothrow) uint8[kQueueSize],
+                  std::memory_order_release);
+  }
+
+  drain();
+  return file != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+bool SessionRecorder::hasRoom(size_t size) const {
+  const uint64 used = cursor - consumed.load(std::memory_order_acquire);
+  return used + size <= (uint64) kQueueSize;
+}
+
+//-----------------------------------------------------------------------------
+bool SessionRecorder::begin(const SessionStart& start, const ParamID* ids,
+                            const float* values) {
+  SessionRecordHeader record;
+  record.type = kSessionStart;
+  record.size = (uint32) (sizeof(SessionStart) +
+                          (sizeof(ParamID) + sizeof(float)) * start.numParams);
+  if (!queue) {
+    queue = storage.load(std::memory_order_acquire);
+    if (!queue) {
+      requested.store(true, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  if (!hasRoom(sizeof(record) + record.size)) {
+    return false;
+  }
+
+  put(record);
+  put(start);
+  for (int32 i = 0; i < start.numParams; i++) {
+    put(ids[i]);
+    put(values[i]);
+  }
+  publish();
+
+  droppedBlocks = 0;
+  capturing = true;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SessionRecorder::end() {
+  if (!capturing) {
+    return;
+  }
+  capturing = false;
+
+  // Without room the worker thread still closes the file on stop()
+  SessionRecordHeader record;
+  record.type = kSessionEnd;
+  if (hasRoom(sizeof(record))) {
+    put(record);
+    publish();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SessionRecorder::captureBlock(ProcessData& data) {
+  if (!capturing) {
+    return;
+  }
+
+  SessionBlock block;
+  block.numSamples = data.numSamples;
+  block.droppedBefore = droppedBlocks;
+  if (data.processContext) {
+    block.flags |= kSessionHasContext;
+  }
+
+  // Sizing pass, the block is queued whole or not at all
+  size_t size = sizeof(SessionBlock);
+  if (data.processContext) {
+    size += sizeof(ProcessContext);
+  }
+  if (IParameterChanges* changes = data.inputParameterChanges) {
+    block.numQueues = changes->getParameterCount();
+    for (int32 q = 0; q < block.numQueues; q++) {
+      IParamValueQueue* paramQueue = changes->getParameterData(q);
+      const int32 numPoints = paramQueue ? paramQueue->getPointCount() : 0;
+      size += sizeof(ParamID) + sizeof(int32) +
+              (sizeof(int32) + sizeof(ParamValue)) * numPoints;
+    }
+  }
+  if (data.inputEvents) {
+    block.numEvents = data.inputEvents->getEventCount();
+    size += sizeof(Event) * block.numEvents;
+  }
+
+  SessionRecordHeader record;
+  record.type = kSessionBlock;
+  record.size = (uint32) size;
+  if (!hasRoom(sizeof(record) + size)) {
+    droppedBlocks++;
+    return;
+  }
+
+  put(record);
+  put(block);
+  if (data.processContext) {
+    put(*data.processContext);
+  }
+  for (int32 q = 0; q < block.numQueues; q++) {
+    IParamValueQueue* paramQueue =
+        data.inputParameterChanges->getParameterData(q);
+    const ParamID id = paramQueue ? paramQueue->getParameterId() : 0;
+    const int32 numPoints = paramQueue ? paramQueue->getPointCount() : 0;
+    put(id);
+    put(numPoints);
+    for (int32 p = 0; p < numPoints; p++) {
+      int32 sampleOffset = 0;
+      ParamValue value = 0.;
+      paramQueue->getPoint(p, sampleOffset, value);
+      put(sampleOffset);
+      put(value);
+    }
+  }
+  for (int32 e = 0; e < block.numEvents; e++) {
+    // An event the list fails to return is kept as an empty one, the
+    // record size is already fixed
+    Event event = {};
+    data.inputEvents->getEvent(e, event);
+    clearEventPointers(event);
+    put(event);
+  }
+  publish();
+  droppedBlocks = 0;
+}
+
+//-----------------------------------------------------------------------------
+std::string SessionRecorder::getCaptureFolder() {
+  std::error_code error;
+  std::filesystem::path folder =
+      std::filesystem::temp_directory_path(error) / "LaserSession";
+  return folder.string();
+}
+
+//-----------------------------------------------------------------------------
+void SessionRecorder::read(uint64 position, void* bytes, size_t size) const {
+  const uint32 index = (uint32) position & (kQueueSize - 1);
+  const size_t first = std::min(size, (size_t) (kQueueSize - index));
+  const uint8* data = storage.load(std::memory_order_relaxed);
+  memcpy(bytes, data + index, first);
+  memcpy(static_cast<uint8*>(bytes) + first, data, size - first);
+}
+
+//-----------------------------------------------------------------------------
+void SessionRecorder::drain() {
+  const uint64 end = written.load(std::memory_order_acquire);
+  uint64 position = consumed.load(std::memory_order_relaxed);
+
+  while (position < end) {
+    SessionRecordHeader record;
+    read(position, &record, sizeof(record));
+
+    if (record.type == kSessionStart) {
+      openFile();
+    }
+
+    // Copied out in at most two runs, the queue wraps at most once
+    if (file) {
+      const uint64 recordEnd = position + sizeof(record) + record.size;
+      for (uint64 at = position; at < recordEnd;) {
+        const uint32 index = (uint32) at & (kQueueSize - 1);
+        const size_t length = std::min((size_t) (recordEnd - at),
+                                    (size_t) (kQueueSize - index));
+        fwrite(storage.load(std::memory_order_relaxed) + index, 1, length,
+               file);
+        at += length;
+      }
+    }
+    position += sizeof(record) + record.size;
+
+    if (record.type == kSessionEnd && file) {
+      fclose(file);
+      file = nullptr;
+    }
+  }
+
+  if (file) {
+    fflush(file);
+  }
+  consumed.store(position, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+void SessionRecorder::openFile() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+
+  std::error_code error;
+  std::filesystem::path folder = getCaptureFolder();
+  std::filesystem::create_directories(folder, error);
+
+  // Same naming as the flight dumps, and never onto another capture
+  std::filesystem::path path =
+      folder / makeUniqueFileName("laser_session", ".lss");
+
+  file = fopen(path.string().c_str(), "wbx");
+  if (file) {
+    const SessionFileHeader header;
+    fwrite(&header, sizeof(header), 1, file);
+  }
+}
+
+//-----------------------------------------------------------------------------
+}  // namespace Radar
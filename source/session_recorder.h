@@ -0,0 +1,252 @@
+/**
+ * @file session_recorder.h
+ *
+ * @brief Streaming capture of the host inputs of the Laser VST Plugin.
+ *
+ * This file defines the SessionRecorder class, which streams every input
+ * the host hands to process() to a file while the capture is on, and the
+ * binary format of the capture.
+ *
+ * @details
+ * Where the FlightRecorder keeps the last blocks and their DSP state for
+ * post-mortems, the session recorder keeps everything from the moment the
+ * capture is switched on, but only what the host sent: the block size, all
+ * points of every parameter queue, every event and the ProcessContext. A
+ * capture of a real session replays into a fresh processor, see
+ * tools/session_replay.cpp, to benchmark and regression-test against the
+ * load hosts actually produce.
+ *
+ * The audio thread serializes each block into a single-producer,
+ * single-consumer byte queue: two counters of written and read bytes, no
+ * locks and no allocation. A block that does not fit is dropped whole and
+ * counted in the next one. The RecorderWorker drains the queue to the
+ * capture file every few milliseconds while a capture runs.
+ *
+ * The queue is not part of the processor's arena: an instance that never
+ * captures never pays for it. The first begin() only asks for it, the
+ * worker allocates it, and a later begin() starts the capture. It is freed
+ * in stop().
+ *
+ * Stream layout: one SessionFileHeader, then records. Each record is a
+ * SessionRecordHeader and its payload, packed without padding:
+ *
+ * - kSessionStart: a SessionStart, then numParams (ParamID, float) pairs,
+ *   the normalized value of every parameter when the capture started.
+ * - kSessionBlock: a SessionBlock, the ProcessContext if kSessionHasContext
+ *   is set, numQueues queues of (ParamID, int32 numPoints) each followed by
+ *   numPoints (int32 sampleOffset, double value) points, then numEvents
+ *   Events.
+ * - kSessionEnd: no payload, the capture was switched off.
+ *
+ * Events keep their type and fixed fields; the pointers of data, text,
+ * chord and scale events are cleared, their payloads are not captured. All
+ * values are in host byte order.
+ *
+ * Features:
+ * - Lock-free, allocation free serialization on the audio thread.
+ * - Unbounded captures, streamed to disk off the audio thread.
+ * - Every parameter point and event, not only the last value per block.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef SESSION_RECORDER_H_
+#define SESSION_RECORDER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "recorder_worker.h"
+
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+#include "pluginterfaces/vst/ivstevents.h"
+#include "pluginterfaces/vst/ivstparameterchanges.h"
+#include "pluginterfaces/vst/ivstprocesscontext.h"
+
+using namespace Steinberg;
+using namespace Vst;
+
+namespace Radar {
+
+/**
+ * @enum SessionRecordType
+ * @brief Kind of a record of the capture stream.
+ */
+enum SessionRecordType : uint32 {
+  kSessionStart = 1,  ///< Capture switched on, with the parameter values.
+  kSessionBlock,      ///< Inputs of one process() call.
+  kSessionEnd         ///< Capture switched off.
+};
+
+/**
+ * @enum SessionBlockFlags
+ * @brief What a block record carries.
+ */
+enum SessionBlockFlags : uint32 {
+  kSessionHasContext = 1 << 0  ///< The host sent a ProcessContext.
+};
+
+/**
+ * @struct SessionFileHeader
+ * @brief Start of a capture file.
+ */
+struct SessionFileHeader {
+  static constexpr uint32 kMagic = 0x3153534C;  ///< "LSS1".
+  static constexpr uint32 kVersion = 1;
+
+  uint32 magic = kMagic;
+  uint32 version = kVersion;
+  uint32 eventSize = sizeof(Event);             ///< Layout check.
+  uint32 contextSize = sizeof(ProcessContext);  ///< Layout check.
+};
+
+/**
+ * @struct SessionRecordHeader
+ * @brief Type and payload size of a record.
+ */
+struct SessionRecordHeader {
+  uint32 type = 0;  ///< SessionRecordType.
+  uint32 size = 0;  ///< Bytes of payload following the header.
+};
+
+/**
+ * @struct SessionStart
+ * @brief Setup of the processor when the capture started.
+ */
+struct SessionStart {
+  double sampleRate = 0.;
+  int32 maxSamplesPerBlock = 0;
+  int32 processMode = 0;
+  int32 symbolicSampleSize = 0;
+  uint32 groupBuses = 0;  ///< Voice groups on their own bus.
+  int32 numParams = 0;    ///< Parameter values following.
+};
+
+/**
+ * @struct SessionBlock
+ * @brief Fixed part of a block record.
+ */
+struct SessionBlock {
+  int32 numSamples = 0;
+  uint32 flags = 0;          ///< SessionBlockFlags.
+  uint32 droppedBefore = 0;  ///< Blocks lost since the previous record.
+  int32 numQueues = 0;       ///< Parameter queues following the context.
+  int32 numEvents = 0;       ///< Events following the queues.
+};
+
+/**
+ * @class SessionRecorder
+ * @brief Serializes the inputs of every block into a lock-free queue and
+ * streams it to a file from the RecorderWorker.
+ */
+class SessionRecorder : public RecorderTask {
+ public:
+  static constexpr int32 kQueueSize = 1 << 20;  ///< Bytes, a power of two.
+
+  SessionRecorder() = default;
+  ~SessionRecorder() override { stop(); }
+
+  SessionRecorder(const SessionRecorder&) = delete;
+  SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+  /**
+   * @brief Empties the queue and adds the recorder to the RecorderWorker.
+   *
+   * Called from setActive(true).
+   */
+  void start();
+
+  /**
+   * @brief Removes the recorder from the RecorderWorker, writes what is
+   * queued, closes the capture file and frees the queue. Called from
+   * setActive(false).
+   */
+  void stop();
+
+  /// Allocates the queue once asked and drains it, on the worker thread.
+  bool poll() override;
+
+  /// Whether blocks are captured, audio thread only.
+  bool isCapturing() const { return capturing; }
+
+  /**
+   * @brief Starts a new capture file, from the audio thread.
+   *
+   * `ids` and `values` hold the `numParams` parameters and their current
+   * normalized values.
+   *
+   * @return false if the queue is not allocated yet (this call asks for
+   * it) or has no room right now.
+   */
+  bool begin(const SessionStart& start, const ParamID* ids,
+             const float* values);
+
+  /// Ends the capture file, from the audio thread.
+  void end();
+
+  /// Queues the inputs of `data`, call before process() consumes them.
+  void captureBlock(ProcessData& data);
+
+  /// Folder the captures are written to.
+  static std::string getCaptureFolder();
+
+ private:
+  /// Writes every complete record in the queue to the capture file.
+  void drain();
+
+  /// Copies `size` bytes at stream position `position` out of the queue.
+  void read(uint64 position, void* bytes, size_t size) const;
+
+  /// Creates a new, uniquely named capture file and writes its header.
+  void openFile();
+
+  // Audio thread
+  /// Whether `size` more bytes fit behind the queued ones.
+  bool hasRoom(size_t size) const;
+
+  /// Appends `size` bytes at the write cursor, not yet published.
+  void put(const void* bytes, size_t size) {
+    const uint32 index = (uint32) cursor & (kQueueSize - 1);
+    const size_t first = std::min(size, (size_t) (kQueueSize - index));
+    memcpy(queue + index, bytes, first);
+    memcpy(queue, static_cast<const uint8*>(bytes) + first, size - first);
+    cursor += size;
+  }
+
+  template <typename T>
+  void put(const T& value) {
+    put(&value, sizeof(T));
+  }
+
+  /// Makes the records put so far visible to the worker thread.
+  void publish() { written.store(cursor, std::memory_order_release); }
+
+  uint8* queue = nullptr;    ///< Audio thread's copy of `storage`.
+  uint64 cursor = 0;         ///< Stream position of the next byte put.
+  uint32 droppedBlocks = 0;  ///< Blocks that did not fit since the last.
+  bool capturing = false;
+
+  // Shared: stream positions, only ever growing
+  std::atomic<uint64> written{0};  ///< Published by the audio thread.
+  std::atomic<uint64> consumed{0};  ///< Released by the worker thread.
+  std::atomic<uint8*> storage{nullptr};  ///< Queue, published by the worker.
+  std::atomic<bool> requested{false};    ///< The audio thread wants it.
+
+  // Worker thread
+  FILE* file = nullptr;
+  bool started = false;  ///< Added to the RecorderWorker.
+};
+
+}  // namespace Radar
+
+#endif  // SESSION_RECORDER_H_
@@ -0,0 +1,148 @@
+/**
+ * @file table_parameter.cpp
+ *
+ * @brief Implementation of the table driven controller parameters of the
+ * Laser VST Plugin.
+ *
+ * This file implements the TableParameter class declared in
+ * table_parameter.h.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - Standard Math Library (math.h)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include "table_parameter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "pluginterfaces/base/fstrdefs.h"
+#include "pluginterfaces/base/ustring.h"
+#include "pluginterfaces/vst/ivstunits.h"
+
+namespace Radar {
+
+// Note names of the pitch classes, the octave follows
+static const char* const kNoteNames[12] = {"C",  "C#", "D",  "D#", "E",  "F",
+                                           "F#", "G",  "G#", "A",  "A#", "B"};
+
+// Gains below this are shown as minus infinity
+static const double kMinGain = 1e-5;
+
+//-----------------------------------------------------------------------------
+// TableParameter
+//-----------------------------------------------------------------------------
+TableParameter::TableParameter(const ParamSpec& newSpec) : spec(newSpec) {
+  UString(info.title, str16BufferSize(String128)).assign(spec.title);
+  UString(info.units, str16BufferSize(String128)).assign(spec.units);
+  info.id = spec.id;
+  info.stepCount = spec.stepCount;
+  info.defaultNormalizedValue = spec.defaultValue;
+  info.unitId = kRootUnitId;
+  info.flags = spec.flags;
+  setNormalized(spec.defaultValue);
+  setPrecision(spec.precision);
+}
+
+//-----------------------------------------------------------------------------
+void TableParameter::toString(ParamValue valueNormalized,
+                              String128 string) const {
+  const double plain = toPlain(valueNormalized);
+  char text[64];
+
+  if (spec.taper == ParamTaper::kList) {
+    UString(string, str16BufferSize(String128))
+        .assign(spec.strings[(int32) plain]);
+    return;
+  }
+
+  switch (spec.format) {
+    case ParamFormat::kDecibel:
+      if (plain < kMinGain) {
+        snprintf(text, sizeof(text), "-oo");
+      } else {
+        snprintf(text, sizeof(text), "%.*f", spec.precision,
+                 20. * log10(plain));
+      }
+      break;
+
+    case ParamFormat::kNote: {
+      const int32 note = (int32) plain;
+      snprintf(text, sizeof(text), "%s%d", kNoteNames[note % 12],
+               note / 12 - 2);
+      break;
+    }
+
+    case ParamFormat::kNumber:
+    default:
+      snprintf(text, sizeof(text), "%.*f", spec.precision, plain);
+      break;
+  }
+  UString(string, str16BufferSize(String128)).fromAscii(text);
+}
+
+//-----------------------------------------------------------------------------
+bool TableParameter::fromString(const TChar* string,
+                                ParamValue& valueNormalized) const {
+  if (spec.taper == ParamTaper::kList) {
+    for (int32 i = 0; i <= spec.stepCount; i++) {
+      if (strcmp16(string, spec.strings[i]) == 0) {
+        valueNormalized = toNormalized(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  char text[64];
+  UString(const_cast<TChar*>(string), tstrlen(string))
+      .toAscii(text, sizeof(text));
+
+  // Note names: a letter, an optional sharp and the octave
+  if (spec.format == ParamFormat::kNote && text[0] != 0) {
+    for (int32 pitchClass = 11; pitchClass >= 0; pitchClass--) {
+      const char* name = kNoteNames[pitchClass];
+      const size_t length = strlen(name);
+      char* end = nullptr;
+      if (strncmp(text, name, length) == 0) {
+        const long octave = strtol(text + length, &end, 10);
+        if (end != text + length) {
+          valueNormalized = toNormalized((octave + 2) * 12 + pitchClass);
+          return true;
+        }
+      }
+    }
+  }
+
+  char* end = nullptr;
+  double value = strtod(text, &end);
+  if (end == text) {
+    return false;
+  }
+  if (spec.format == ParamFormat::kDecibel) {
+    value = pow(10., value / 20.);
+  }
+  valueNormalized = toNormalized(value);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+ParamValue TableParameter::toPlain(ParamValue valueNormalized) const {
+  return Radar::toPlain(spec, valueNormalized);
+}
+
+//-----------------------------------------------------------------------------
+ParamValue TableParameter::toNormalized(ParamValue plainValue) const {
+  return Radar::toNormalized(spec, plainValue);
+}
+
+}  // namespace Radar
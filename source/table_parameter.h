@@ -0,0 +1,61 @@
+/**
+ * @file table_parameter.h
+ *
+ * @brief Controller parameter described by a row of the parameter table.
+ *
+ * This file defines the TableParameter class, through which the Laser
+ * Controller registers every row of kParamTable.
+ *
+ * @details
+ * The parameter info (title, unit, steps, default, flags) is filled from the
+ * ParamSpec, and the conversions between normalized, plain and displayed
+ * values follow its taper and format. The host therefore shows the value the
+ * DSP actually uses, in the unit it is labeled with.
+ *
+ * Features:
+ * - Plain values in the unit of the parameter, lists by name.
+ * - Gains in dB and MIDI notes by name.
+ * - Parsing of typed-in values in the same formats.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef TABLE_PARAMETER_H_
+#define TABLE_PARAMETER_H_
+
+#include "param_table.h"
+
+#include "public.sdk/source/vst/vstparameters.h"
+
+namespace Radar {
+
+/**
+ * @class TableParameter
+ * @brief Parameter converting and formatting as its ParamSpec says.
+ */
+class TableParameter : public Parameter {
+ public:
+  explicit TableParameter(const ParamSpec& spec);
+
+  // Parameter overrides
+  void toString(ParamValue valueNormalized,
+                String128 string) const SMTG_OVERRIDE;
+  bool fromString(const TChar* string,
+                  ParamValue& valueNormalized) const SMTG_OVERRIDE;
+  ParamValue toPlain(ParamValue valueNormalized) const SMTG_OVERRIDE;
+  ParamValue toNormalized(ParamValue plainValue) const SMTG_OVERRIDE;
+
+ private:
+  const ParamSpec& spec;  ///< Row of kParamTable, lives as long as the code.
+};
+
+}  // namespace Radar
+
+#endif  // TABLE_PARAMETER_H_
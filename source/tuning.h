@@ -0,0 +1,87 @@
+/**
+ * @file tuning.h
+ *
+ * @brief Tuning table of the Laser VST Plugin.
+ *
+ * This file defines the TuningTable class, which holds the fixed-point phase
+ * increment of every MIDI note for the current sample rate, and the helpers
+ * that retune such an increment.
+ *
+ * @details
+ * The table is computed in double precision once per sample rate, so a
+ * NoteOn only looks its increment up instead of calling powf(). Fine tuning
+ * (NoteOn cents, the tuning expression, pitch modulation) is applied as a
+ * ratio through scaleIncrement(). Frequencies are limited to kMaxCycles
+ * cycles per sample, just below Nyquist: taken modulo the cycle they would
+ * fold back to arbitrary low notes, and above Nyquist they would alias.
+ *
+ * Features:
+ * - 12-TET table referenced to A4 = 440 Hz.
+ * - Rounded, drift-free Phase increments.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ * - Standard Math Library (math.h)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef TUNING_H_
+#define TUNING_H_
+
+#include <cmath>
+
+#include "voice.h"
+
+// MIDI constants
+constexpr int kMIDINoteA4 = 69;         ///< MIDI note number for A4 (440 Hz).
+constexpr float kFrequencyA4 = 440.0f;  ///< Frequency of A4 in Hz.
+
+namespace Radar {
+
+/**
+ * @class TuningTable
+ * @brief Phase increment of every MIDI note at one sample rate.
+ */
+class TuningTable {
+ public:
+  static constexpr int32 kNumNotes = 128;   ///< MIDI pitches 0..127.
+  static constexpr double kMaxCycles = 0.45;  ///< Highest frequency / rate.
+
+  /// Recomputes the table for `sampleRate`.
+  void setup(double sampleRate) {
+    for (int32 note = 0; note < kNumNotes; note++) {
+      double hz = kFrequencyA4 * exp2((note - kMIDINoteA4) / 12.);
+      increments[note] = toIncrement(hz / sampleRate);
+    }
+  }
+
+  /// Increment of MIDI `pitch`, clamped to 0..127.
+  Phase getIncrement(int16 pitch) const {
+    return increments[pitch < 0 ? 0 : (pitch < kNumNotes ? pitch
+                                                          : kNumNotes - 1)];
+  }
+
+  /// Increment scaled by the frequency ratio `ratio`.
+  static Phase scaleIncrement(Phase increment, double ratio) {
+    return toIncrement(increment * ratio / kPhaseCycle);
+  }
+
+  /// Increment of a frequency given in cycles per sample, limited to
+  /// 0..kMaxCycles.
+  static Phase toIncrement(double cycles) {
+    cycles = cycles < 0. ? 0. : (cycles < kMaxCycles ? cycles : kMaxCycles);
+    return (Phase) (cycles * kPhaseCycle + 0.5);
+  }
+
+ private:
+  Phase increments[kNumNotes] = {};
+};
+
+}  // namespace Radar
+
+#endif  // TUNING_H_
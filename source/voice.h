@@ -0,0 +1,123 @@
+/**
+ * @file voice.h
+ *
+ * @brief Voice state for the Laser VST Plugin.
+ *
+ * This file defines the Voice structure, which holds the per-note state
+ * (oscillator phases, envelope and gain) of one polyphonic voice, and the
+ * VoiceExpression structure, which holds its note expression lane.
+ *
+ * @details
+ * Voices are mutated on every sample of every block, so their layout is
+ * chosen for the cache: a Voice is exactly 32 bytes and 32-byte aligned, so
+ * two voices share a cache line and the processor's bank of 16 voices, 8
+ * playing and 8 spare for stolen notes, fills eight 64-byte lines (four on
+ * 128-byte lines). Fields read in the per-sample loop come first.
+ *
+ * Oscillator phases are 32-bit fixed point (Phase): a full cycle is 2^32 and
+ * wrapping is the natural unsigned overflow. Accumulation is exact, so a
+ * held note never drifts, and there is no wrap test in the per-sample loop.
+ *
+ * Features:
+ * - Compact, cache-line friendly voice layout.
+ * - Drift-free fixed-point oscillator phases shared by every waveform.
+ * - Attack/release envelope state.
+ * - Per-voice note expression lanes (tuning, volume, pressure, pan,
+ *   brightness).
+ * - Cache line size constant used to lay out per-instance hot state.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef VOICE_H_
+#define VOICE_H_
+
+#include <cstddef>
+
+#include "pluginterfaces/vst/vsttypes.h"
+
+using namespace Steinberg;
+
+/**
+ * @brief Granularity of destructive interference between threads.
+ *
+ * Apple Silicon cores use 128-byte lines, everything else we ship on uses 64.
+ */
+#if defined(__APPLE__) && defined(__aarch64__)
+constexpr size_t kCacheLineSize = 128;
+#else
+constexpr size_t kCacheLineSize = 64;
+#endif
+
+/**
+ * @brief Fixed-point oscillator phase, a full cycle is 2^32.
+ */
+using Phase = uint32;
+
+constexpr double kPhaseCycle = 4294967296.;  ///< One cycle, 2^32.
+
+/**
+ * @enum EnvelopePhase
+ * @brief Stage of the attack/release envelope of a voice.
+ */
+enum EnvelopePhase : uint8 {
+  kAttackPhase = 0,  ///< Level rises linearly towards 1.
+  kReleasePhase,     ///< Level decays exponentially towards 0.
+  kStealPhase        ///< Like release, but fast: the voice was stolen.
+};
+
+/**
+ * @struct Voice
+ * @brief State of a single synthesizer voice.
+ */
+struct alignas(32) Voice {
+  Phase phase1 = 0;           ///< Phase of Oscillator 1.
+  Phase phase2 = 0;           ///< Phase of Oscillator 2.
+  Phase phaseIncrement = 0;   ///< Phase increment per sample.
+  float envelopeLevel = 0.f;  ///< Current envelope level [0..1].
+  float volume = 0.f;         ///< Voice volume.
+  float gainReduction = 0.f;  ///< Gain reduction derived from velocity.
+  uint8 envelopePhase = kAttackPhase;  ///< Current envelope stage.
+  bool active = false;                 ///< Whether the voice is sounding.
+  uint8 group = 0;                     ///< VoiceGroup, selects the bus.
+
+  static constexpr float attackTime = 0.01f;  ///< Attack time in seconds.
+  static constexpr float releaseTime = 0.5f;  ///< Release time in seconds.
+  static constexpr float stealTime = 0.005f;  ///< Steal fade in seconds.
+};
+
+static_assert(sizeof(Voice) == 32, "Voice must stay half a cache line");
+
+/**
+ * @struct VoiceExpression
+ * @brief Note identity and note expression lane of a voice.
+ *
+ * Note expression events only update the target values here. The voice
+ * kernel reads them once per sub-block and ramps volume and pan from the
+ * gains it applied last, so nothing is looked up per sample.
+ */
+struct alignas(16) VoiceExpression {
+  int32 noteId = -1;        ///< Host note ID, -1 if the host sent none.
+  int16 channel = 0;        ///< MIDI channel of the note.
+  int16 pitch = 0;          ///< MIDI pitch of the note.
+  float tuning = 1.f;       ///< Pitch ratio from the tuning expression.
+  float volume = 1.f;       ///< Linear gain from the volume expression.
+  float pressure = 1.f;     ///< Linear gain from the pressure expression.
+  float pan = 0.5f;         ///< Pan expression, 0 = left, 1 = right.
+  float brightness = 1.f;   ///< Oscillator 2 level multiplier.
+  float gainL = 1.f;        ///< Left gain applied at the last sub-block end.
+  float gainR = 1.f;        ///< Right gain applied at the last sub-block end.
+  float syncBlep = 0.f;     ///< Pending second half of a hard sync step.
+};
+
+static_assert(sizeof(VoiceExpression) == 48,
+              "VoiceExpression lanes must pack three to two cache lines");
+
+#endif  // VOICE_H_
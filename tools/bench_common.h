@@ -0,0 +1,174 @@
+/**
+ * @file bench_common.h
+ *
+ * @brief Minimal host harness shared by the Laser benchmarks and tools.
+ *
+ * This file defines ProcessorHarness, which owns one LaserProcessor together
+ * with everything a host would hand to it: process setup, process context,
+ * output buffers, an event list and parameter changes.
+ *
+ * @details
+ * The harness drives the processor through the regular VST3 life cycle
+ * (initialize, setupProcessing, setActive, process) without loading the
+ * plug-in module, so benchmarks measure the DSP code and nothing else.
+ * Events and parameter changes queued between two blocks are delivered with
+ * the next call to processBlock() and cleared afterwards. The voice group
+ * buses are only handed to the processor once setGroupBuses() was called.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK (hosting helpers)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#ifndef BENCH_COMMON_H_
+#define BENCH_COMMON_H_
+
+#include <chrono>
+#include <vector>
+
+#include "laser_processor.h"
+
+#include "public.sdk/source/vst/hosting/eventlist.h"
+#include "public.sdk/source/vst/hosting/parameterchanges.h"
+
+namespace Radar {
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+/// Maximum number of events the harness can queue for one block.
+constexpr int32 kMaxEventsPerBlock = 4096;
+
+/**
+ * @class ProcessorHarness
+ * @brief Owns a LaserProcessor and plays the host role for it.
+ */
+class ProcessorHarness {
+ public:
+  /// Main output followed by one bus per voice group.
+  static constexpr int32 kNumBuses = 1 + kNumVoiceGroups;
+
+  ProcessorHarness(SampleRate sampleRate, int32 blockSize)
+      : events(kMaxEventsPerBlock) {
+    setup.processMode = kRealtime;
+    setup.symbolicSampleSize = kSample32;
+    setup.maxSamplesPerBlock = blockSize;
+    setup.sampleRate = sampleRate;
+
+    context = {};
+    context.sampleRate = sampleRate;
+    context.tempo = 120.;
+    context.state = ProcessContext::kPlaying | ProcessContext::kTempoValid;
+
+    for (int32 bus = 0; bus < kNumBuses; bus++) {
+      for (int32 channel = 0; channel < 2; channel++) {
+        buffers[bus * 2 + channel].resize(blockSize);
+        channels[bus * 2 + channel] = buffers[bus * 2 + channel].data();
+      }
+      outputs[bus].numChannels = 2;
+      outputs[bus].channelBuffers32 = &channels[bus * 2];
+    }
+
+    data.processMode = kRealtime;
+    data.symbolicSampleSize = kSample32;
+    data.numSamples = blockSize;
+    data.numOutputs = 1;
+    data.outputs = outputs;
+    data.inputParameterChanges = &paramChanges;
+    data.inputEvents = &events;
+    data.processContext = &context;
+
+    processor = new LaserProcessor;
+    processor->initialize(nullptr);
+    processor->setupProcessing(setup);
+    processor->setActive(true);
+    processor->setProcessing(true);
+  }
+
+  ~ProcessorHarness() {
+    processor->setProcessing(false);
+    processor->setActive(false);
+    processor->terminate();
+    processor->release();
+  }
+
+  ProcessorHarness(const ProcessorHarness&) = delete;
+  ProcessorHarness& operator=(const ProcessorHarness&) = delete;
+
+  /// Queues a NoteOn event for the next block.
+  void noteOn(int16 pitch, float velocity, int32 sampleOffset = 0) {
+    Event event = {};
+    event.type = Event::kNoteOnEvent;
+    event.sampleOffset = sampleOffset;
+    event.noteOn.pitch = pitch;
+    event.noteOn.velocity = velocity;
+    event.noteOn.noteId = -1;
+    events.addEvent(event);
+  }
+
+  /// Queues a NoteOff event for the next block.
+  void noteOff(int16 pitch, int32 sampleOffset = 0) {
+    Event event = {};
+    event.type = Event::kNoteOffEvent;
+    event.sampleOffset = sampleOffset;
+    event.noteOff.pitch = pitch;
+    event.noteOff.noteId = -1;
+    events.addEvent(event);
+  }
+
+  /// Queues a normalized parameter change for the next block.
+  void setParameter(ParamID id, ParamValue value, int32 sampleOffset = 0) {
+    int32 index = 0;
+    if (IParamValueQueue* queue = paramChanges.addParameterData(id, index)) {
+      queue->addPoint(sampleOffset, value, index);
+    }
+  }
+
+  /**
+   * @brief Activates the bus of each voice group in `mask` (bit n for
+   * VoiceGroup n) and hands all buses to process() from now on.
+   *
+   * Buses can only be switched while the processor is inactive, so it is
+   * deactivated for the switch, which resets its voices.
+   */
+  void setGroupBuses(uint32 mask) {
+    processor->setProcessing(false);
+    processor->setActive(false);
+    for (int32 group = 0; group < kNumVoiceGroups; group++) {
+      processor->activateBus(kAudio, kOutput, kFirstGroupBus + group,
+                             (mask >> group) & 1);
+    }
+    processor->setActive(true);
+    processor->setProcessing(true);
+    data.numOutputs = kNumBuses;
+  }
+
+  /// Runs one block and clears the queued inputs.
+  void processBlock() {
+    processor->process(data);
+    events.clear();
+    paramChanges.clearQueue();
+    context.projectTimeSamples += data.numSamples;
+    context.continousTimeSamples += data.numSamples;
+  }
+
+  LaserProcessor* processor = nullptr;
+  ProcessSetup setup = {};
+  ProcessContext context = {};
+  ProcessData data;
+  EventList events;
+  ParameterChanges paramChanges;
+  AudioBusBuffers outputs[kNumBuses] = {};
+  Sample32* channels[kNumBuses * 2] = {};
+  std::vector<Sample32> buffers[kNumBuses * 2];  ///< Left, right per bus.
+};
+
+}  // namespace Bench
+}  // namespace Radar
+
+#endif  // BENCH_COMMON_H_
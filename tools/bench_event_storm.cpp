@@ -0,0 +1,226 @@
+/**
+ * @file bench_event_storm.cpp
+ *
+ * @brief Event storm benchmark for the Laser Processor.
+ *
+ * This benchmark feeds a LaserProcessor blocks of 1000 events each, the way
+ * an arpeggiator or another MIDI generating plug-in upstream floods it, and
+ * reports what the event handling costs on top of rendering.
+ *
+ * @details
+ * Every block carries a mix of what such plug-ins send, in the event list
+ * order of a host merging several streams (so it is not sorted):
+ *
+ * - Short arpeggio notes that start and end within the block.
+ * - Notes that are held across blocks and released later.
+ * - Repeated NoteOffs of notes that are already released.
+ * - Streams of volume and tuning expression values on the held notes.
+ *
+ * The same number of blocks is rendered once with the storm and once with
+ * only the held notes and the expression values the storm settles on, so
+ * both render the same; the difference is the event cost, printed per block
+ * and per event. The worst block time with the storm is printed as well, as a
+ * fraction of the block's deadline.
+ *
+ * Usage:
+ *   laser_bench_event_storm [--events E] [--blocks B] [--block-size S]
+ *                           [--sample-rate R]
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK (hosting helpers)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bench_common.h"
+
+#include "pluginterfaces/vst/ivstnoteexpression.h"
+
+using namespace Radar;
+using namespace Radar::Bench;
+
+namespace {
+
+struct Options {
+  int32 events = 1000;
+  int blocks = 5000;
+  int32 blockSize = 256;
+  SampleRate sampleRate = 48000.;
+};
+
+/// Events of every block: the held notes and their final expressions.
+constexpr int32 kBaseEvents = 4;
+
+struct RunResult {
+  double seconds = 0.;     ///< Total time spent in process().
+  double worstBlock = 0.;  ///< Longest process() call in seconds.
+};
+
+/// Small deterministic generator, the storm must not depend on the libc.
+struct Random {
+  uint32 state = 0x12345678u;
+
+  uint32 next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  int32 below(int32 limit) { return (int32) (next() % (uint32) limit); }
+};
+
+void addExpression(ProcessorHarness& harness, int32 noteId,
+                   NoteExpressionTypeID type, double value, int32 offset) {
+  Event event = {};
+  event.type = Event::kNoteExpressionValueEvent;
+  event.sampleOffset = offset;
+  event.noteExpressionValue.noteId = noteId;
+  event.noteExpressionValue.typeId = type;
+  event.noteExpressionValue.value = value;
+  harness.events.addEvent(event);
+}
+
+/**
+ * @brief Queues `count` storm events for the next block.
+ *
+ * `block` selects the held notes: one starts and the one started eight
+ * blocks earlier ends every block.
+ */
+void queueStorm(ProcessorHarness& harness, Random& random, int32 count,
+                int block) {
+  const int32 blockSize = harness.data.numSamples;
+  int32 queued = 0;
+
+  // Held notes, in a rotating window of eight, and the expression values
+  // they end the block with
+  const int16 heldPitch = (int16) (36 + block % 24);
+  harness.noteOn(heldPitch, 0.6f, random.below(blockSize));
+  harness.noteOff((int16) (36 + (block + 16) % 24), random.below(blockSize));
+  addExpression(harness, -1, kVolumeTypeID, 0.8, blockSize - 1);
+  addExpression(harness, -1, kTuningTypeID, 0.5, blockSize - 1);
+  queued += kBaseEvents;
+
+  while (queued < count) {
+    const int32 offset = random.below(blockSize);
+    switch (random.below(4)) {
+      case 0: {
+        // Arpeggio step, on and off again within the block
+        const int16 pitch = (int16) (60 + random.below(24));
+        const int32 length = 1 + random.below(blockSize / 4);
+        harness.noteOn(pitch, 0.5f, offset);
+        harness.noteOff(pitch, std::min(blockSize - 1, offset + length));
+        queued += 2;
+        break;
+      }
+      case 1:
+        // Redundant release of a note that is not playing
+        harness.noteOff((int16) (84 + random.below(12)), offset);
+        queued++;
+        break;
+      default:
+        // Controller streams on the held notes, which carry no ID here
+        addExpression(harness, -1,
+                      random.below(2) ? kVolumeTypeID : kTuningTypeID,
+                      random.below(1000) / 1000.,
+                      std::min(blockSize - 2, offset));
+        queued++;
+        break;
+    }
+  }
+}
+
+/**
+ * @brief Renders `options.blocks` blocks with `eventsPerBlock` events each,
+ * only the held notes and their expressions when it is kBaseEvents.
+ */
+RunResult run(const Options& options, int32 eventsPerBlock) {
+  ProcessorHarness harness(options.sampleRate, options.blockSize);
+  Random random;
+  RunResult result;
+
+  for (int b = -64; b < options.blocks; ++b) {
+    queueStorm(harness, random, eventsPerBlock, b + 64);
+
+    auto start = Clock::now();
+    harness.processBlock();
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    // The first blocks only warm up caches and branch predictors
+    if (b >= 0) {
+      result.seconds += seconds;
+      result.worstBlock = std::max(result.worstBlock, seconds);
+    }
+  }
+  return result;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    if (strcmp(arg, "--events") == 0) {
+      options.events = atoi(value);
+    } else if (strcmp(arg, "--blocks") == 0) {
+      options.blocks = atoi(value);
+    } else if (strcmp(arg, "--block-size") == 0) {
+      options.blockSize = atoi(value);
+    } else if (strcmp(arg, "--sample-rate") == 0) {
+      options.sampleRate = atof(value);
+    } else {
+      return false;
+    }
+    ++i;
+  }
+  return options.events > kBaseEvents && options.blocks > 0 &&
+         options.blockSize > 0 && options.sampleRate > 0.;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr,
+            "usage: %s [--events E] [--blocks B] [--block-size S] "
+            "[--sample-rate R]\n",
+            argv[0]);
+    return 1;
+  }
+
+  printf("%d blocks of %d samples at %.0f Hz, %d events per block\n\n",
+         options.blocks, options.blockSize, options.sampleRate,
+         options.events);
+
+  RunResult quiet = run(options, kBaseEvents);
+  RunResult storm = run(options, options.events);
+
+  const double deadline = options.blockSize / options.sampleRate;
+  const double eventCost = (storm.seconds - quiet.seconds) / options.blocks;
+  const int32 stormEvents = options.events - kBaseEvents;
+  printf("%12s %14s %14s %12s\n", "", "us/block", "worst [us]",
+         "worst/deadline");
+  printf("%12s %14.2f %14.2f %12.3f\n", "held notes",
+         quiet.seconds / options.blocks * 1e6, quiet.worstBlock * 1e6,
+         quiet.worstBlock / deadline);
+  printf("%12s %14.2f %14.2f %12.3f\n", "storm",
+         storm.seconds / options.blocks * 1e6, storm.worstBlock * 1e6,
+         storm.worstBlock / deadline);
+  printf("\nevent handling: %.2f us per block, %.1f ns per event\n",
+         eventCost * 1e6, eventCost / stormEvents * 1e9);
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file bench_multi_instance.cpp
+ *
+ * @brief Multi-instance scaling benchmark for the Laser Processor.
+ *
+ * This benchmark runs N independent LaserProcessor instances on N threads,
+ * the way a host spreads plug-in instances over its worker threads, and
+ * reports how the aggregate throughput scales with N.
+ *
+ * @details
+ * Every thread creates its own processor (so its memory is first touched by
+ * the thread that uses it), starts a full chord and then renders a fixed
+ * number of blocks. All threads start together behind a barrier. For each N
+ * the benchmark prints the wall time, the throughput in rendered samples per
+ * second and the scaling efficiency:
+ *
+ *   efficiency(N) = throughput(N) / (N * throughput(1))
+ *
+ * Efficiency well below 1.0 while there are enough idle cores points at
+ * shared cache lines or memory bandwidth. Run it under `perf` to confirm:
+ *
+ *   perf stat -e cycles,instructions,cache-misses,L1-dcache-load-misses \
+ *     ./laser_bench_multi_instance --threads 8
+ *   perf c2c record ./laser_bench_multi_instance --threads 8
+ *
+ * `perf c2c report` must not list any LaserProcessor line as a HITM hotspot.
+ *
+ * Usage:
+ *   laser_bench_multi_instance [--threads N] [--blocks B] [--block-size S]
+ *                              [--sample-rate R]
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK (hosting helpers)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+
+using namespace Radar;
+using namespace Radar::Bench;
+
+namespace {
+
+struct Options {
+  int threads = (int) std::thread::hardware_concurrency();
+  int blocks = 20000;
+  int32 blockSize = 256;
+  SampleRate sampleRate = 48000.;
+};
+
+struct RunResult {
+  double seconds = 0.;
+  double samplesPerSecond = 0.;
+};
+
+/**
+ * @brief Renders `blocks` blocks with `numThreads` concurrent processors.
+ */
+RunResult run(const Options& options, int numThreads) {
+  std::atomic<int> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<double> seconds(numThreads, 0.);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      ProcessorHarness harness(options.sampleRate, options.blockSize);
+
+      // Hold a full chord so that every playing voice is rendering; more
+      // notes would only be stolen and fade out on the spare voices
+      for (int v = 0; v < kMaxPolyphony; ++v) {
+        harness.noteOn((int16) (48 + v * 3), 0.8f);
+      }
+      // Warm up caches and branch predictors
+      for (int b = 0; b < 64; ++b) {
+        harness.processBlock();
+      }
+
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+
+      auto start = Clock::now();
+      for (int b = 0; b < options.blocks; ++b) {
+        harness.processBlock();
+      }
+      seconds[t] = std::chrono::duration<double>(Clock::now() - start).count();
+    });
+  }
+
+  while (ready.load() < numThreads) {
+    std::this_thread::yield();
+  }
+  go.store(true, std::memory_order_release);
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  RunResult result;
+  for (double s : seconds) {
+    result.seconds = std::max(result.seconds, s);
+  }
+  double samples =
+      (double) numThreads * options.blocks * options.blockSize;
+  result.samplesPerSecond = samples / result.seconds;
+  return result;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    if (strcmp(arg, "--threads") == 0) {
+      options.threads = atoi(value);
+    } else if (strcmp(arg, "--blocks") == 0) {
+      options.blocks = atoi(value);
+    } else if (strcmp(arg, "--block-size") == 0) {
+      options.blockSize = atoi(value);
+    } else if (strcmp(arg, "--sample-rate") == 0) {
+      options.sampleRate = atof(value);
+    } else {
+      return false;
+    }
+    ++i;
+  }
+  return options.threads > 0 && options.blocks > 0 && options.blockSize > 0 &&
+         options.sampleRate > 0.;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr,
+            "usage: %s [--threads N] [--blocks B] [--block-size S] "
+            "[--sample-rate R]\n",
+            argv[0]);
+    return 1;
+  }
+
+  printf("sizeof(LaserProcessor) = %zu, alignof = %zu, sizeof(Voice) = %zu\n",
+         sizeof(LaserProcessor), alignof(LaserProcessor), sizeof(Voice));
+  printf("%d blocks of %d samples at %.0f Hz per instance\n\n",
+         options.blocks, options.blockSize, options.sampleRate);
+  printf("%8s %12s %16s %12s %10s\n", "threads", "wall [s]", "samples/s",
+         "x realtime", "efficiency");
+
+  // 1, 2, 4, ... and finally the requested thread count
+  std::vector<int> threadCounts;
+  for (int n = 1; n < options.threads; n *= 2) {
+    threadCounts.push_back(n);
+  }
+  threadCounts.push_back(options.threads);
+
+  double singleThroughput = 0.;
+  for (int n : threadCounts) {
+    RunResult result = run(options, n);
+    if (n == 1) {
+      singleThroughput = result.samplesPerSecond;
+    }
+    double efficiency = result.samplesPerSecond / (n * singleThroughput);
+    printf("%8d %12.3f %16.0f %12.1f %10.3f\n", n, result.seconds,
+           result.samplesPerSecond,
+           result.samplesPerSecond / options.sampleRate, efficiency);
+  }
+
+  return 0;
+}
@@ -0,0 +1,305 @@
+/**
+ * @file flight_replay.cpp
+ *
+ * @brief Offline replay of a Laser flight recorder dump.
+ *
+ * This tool loads a dump written by the FlightRecorder of a LaserProcessor,
+ * restores the DSP state of its oldest block into a fresh processor, feeds
+ * it the recorded events and parameter changes block by block and compares
+ * the hash of every output block with the recorded one.
+ *
+ * @details
+ * The processor is set up with the recorded sample rate and maximum block
+ * size and gets the same voice group buses. The quality level of each block
+ * is forced to the recorded one instead of being measured, so voice
+ * stealing happens exactly where it happened live.
+ *
+ * Replay is bit exact unless the recorder marked the dump with replay
+ * limits: it starts in the middle of a session while the delay or chorus
+ * ran, whose lines are not recorded, or a block carried more events or
+ * parameter changes than the ring holds. Such dumps are still replayed but
+ * their hashes are not compared. Otherwise the tool reports the first block
+ * that diverges; with --raw it also writes the replayed main output as
+ * interleaved 32-bit float stereo.
+ *
+ * Usage:
+ *   laser_flight_replay <dump.lfr> [--raw output.f32] [--verbose]
+ *
+ * Exit status: 0 if every block matched, 2 on divergence, 3 if the dump
+ * cannot replay bit exactly, 1 on errors.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK (hosting helpers)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "bench_common.h"
+#include "flight_recorder.h"
+
+using namespace Radar;
+using namespace Radar::Bench;
+
+namespace {
+
+struct Options {
+  const char* dumpPath = nullptr;
+  const char* rawPath = nullptr;
+  bool verbose = false;
+};
+
+/// One record of the dump, pointing into the loaded file.
+struct Record {
+  FlightBlockHeader header;
+  const Event* events = nullptr;
+  const FlightParamChange* params = nullptr;
+};
+
+const char* triggerName(uint32 trigger) {
+  switch (trigger) {
+    case kFlightTriggerUser:
+      return "user";
+    case kFlightTriggerClip:
+      return "clip";
+    case kFlightTriggerOverrun:
+      return "overrun";
+    default:
+      return "none";
+  }
+}
+
+/**
+ * @brief Parses the dump in `file` into its header and records.
+ *
+ * @return false, with a message printed, if the file is not a dump of this
+ * build's layout.
+ */
+bool parseDump(const std::vector<uint8>& file, FlightDumpHeader& header,
+               std::vector<Record>& records) {
+  if (file.size() < sizeof(FlightDumpHeader)) {
+    fprintf(stderr, "error: file too short for a dump header\n");
+    return false;
+  }
+  memcpy(&header, file.data(), sizeof(header));
+
+  const FlightDumpHeader expected;
+  if (header.magic != expected.magic || header.version != expected.version) {
+    fprintf(stderr, "error: not a Laser flight recorder dump\n");
+    return false;
+  }
+  if (header.blockHeaderSize != expected.blockHeaderSize ||
+      header.eventSize != expected.eventSize ||
+      header.paramChangeSize != expected.paramChangeSize) {
+    fprintf(stderr, "error: dump written by a build with another layout\n");
+    return false;
+  }
+
+  size_t position = sizeof(FlightDumpHeader);
+  for (uint32 i = 0; i < header.numBlocks; i++) {
+    Record record;
+    if (position + sizeof(FlightBlockHeader) > file.size()) {
+      fprintf(stderr, "error: dump truncated at record %u\n", i);
+      return false;
+    }
+    memcpy(&record.header, file.data() + position, sizeof(FlightBlockHeader));
+    position += sizeof(FlightBlockHeader);
+
+    const FlightBlockHeader& block = record.header;
+    size_t eventBytes = sizeof(Event) * (size_t) block.numEvents;
+    size_t paramBytes =
+        sizeof(FlightParamChange) * (size_t) block.numParamChanges;
+    if (block.numEvents < 0 || block.numEvents > FlightBlock::kMaxEvents ||
+        block.numParamChanges < 0 ||
+        block.numParamChanges > FlightBlock::kMaxParamChanges ||
+        position + eventBytes + paramBytes > file.size()) {
+      fprintf(stderr, "error: dump corrupt at record %u\n", i);
+      return false;
+    }
+
+    // Records are packed, the payloads are copied out before use
+    record.events = reinterpret_cast<const Event*>(file.data() + position);
+    position += eventBytes;
+    record.params =
+        reinterpret_cast<const FlightParamChange*>(file.data() + position);
+    position += paramBytes;
+
+    records.push_back(record);
+  }
+  return true;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--verbose") == 0) {
+      options.verbose = true;
+    } else if (strcmp(arg, "--raw") == 0 && i + 1 < argc) {
+      options.rawPath = argv[++i];
+    } else if (arg[0] != '-' && !options.dumpPath) {
+      options.dumpPath = arg;
+    } else {
+      return false;
+    }
+  }
+  return options.dumpPath != nullptr;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr, "usage: %s <dump.lfr> [--raw output.f32] [--verbose]\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::ifstream stream(options.dumpPath, std::ios::binary);
+  if (!stream) {
+    fprintf(stderr, "error: cannot open %s\n", options.dumpPath);
+    return 1;
+  }
+  std::vector<uint8> file((std::istreambuf_iterator<char>(stream)),
+                          std::istreambuf_iterator<char>());
+
+  FlightDumpHeader dump;
+  std::vector<Record> records;
+  if (!parseDump(file, dump, records)) {
+    return 1;
+  }
+  if (records.empty() || dump.sampleRate <= 0. ||
+      dump.maxSamplesPerBlock <= 0) {
+    fprintf(stderr, "error: dump holds no replayable blocks\n");
+    return 1;
+  }
+
+  printf("%s: %u blocks at %.0f Hz, trigger %s\n", options.dumpPath,
+         dump.numBlocks, dump.sampleRate, triggerName(dump.trigger));
+
+  // Blocks the dump thread skipped leave gaps, replay the last contiguous
+  // run of blocks
+  size_t first = 0;
+  for (size_t i = 1; i < records.size(); i++) {
+    if (records[i].header.index != records[i - 1].header.index + 1) {
+      first = i;
+    }
+  }
+  if (first > 0) {
+    printf("skipping %zu blocks before a gap in the recording\n", first);
+  }
+
+  const FlightBlockHeader& start = records[first].header;
+  if (dump.replayLimits & kFlightEffectTails) {
+    printf("dump starts at block %llu with an effect running: its earlier "
+           "tail is not recorded\n",
+           (unsigned long long) start.index);
+  }
+  if (dump.replayLimits & kFlightInputsTruncated) {
+    printf("dump lost events or parameter changes of some blocks\n");
+  }
+
+  ProcessorHarness harness(dump.sampleRate, dump.maxSamplesPerBlock);
+  if (start.groupBuses != 0) {
+    harness.setGroupBuses(start.groupBuses);
+  }
+  harness.processor->restoreFlightState(start);
+
+  FILE* raw = nullptr;
+  if (options.rawPath && !(raw = fopen(options.rawPath, "wb"))) {
+    fprintf(stderr, "error: cannot write %s\n", options.rawPath);
+    return 1;
+  }
+
+  size_t divergent = 0;
+  std::vector<Sample32> interleaved;
+  for (size_t i = first; i < records.size(); i++) {
+    const Record& record = records[i];
+    const FlightBlockHeader& header = record.header;
+    if (header.numSamples < 0 || header.numSamples > dump.maxSamplesPerBlock) {
+      fprintf(stderr, "error: block %llu has %d samples\n",
+              (unsigned long long) header.index, header.numSamples);
+      if (raw) {
+        fclose(raw);
+      }
+      return 1;
+    }
+
+    harness.processor->forceQualityLevel(header.governorLevel);
+    harness.data.numSamples = header.numSamples;
+    harness.context.projectTimeSamples = header.projectTimeSamples;
+    harness.context.tempo = header.tempo;
+    harness.context.state = header.contextState;
+
+    for (int32 e = 0; e < header.numEvents; e++) {
+      Event event;
+      memcpy(&event, &record.events[e], sizeof(Event));
+      harness.events.addEvent(event);
+    }
+    for (int32 p = 0; p < header.numParamChanges; p++) {
+      FlightParamChange change;
+      memcpy(&change, &record.params[p], sizeof(change));
+      harness.setParameter(change.id, change.value, change.sampleOffset);
+    }
+
+    harness.processBlock();
+
+    const Sample32* left = harness.buffers[0].data();
+    const Sample32* right = harness.buffers[1].data();
+    uint32 hash = FlightRecorder::hashOutput(left, right, header.numSamples);
+
+    if (options.verbose || (header.flags & ~kFlightEffectsOn) != 0) {
+      printf("block %llu: %d samples, load %.2f, peak %.3f, level %d%s%s%s\n",
+             (unsigned long long) header.index, header.numSamples,
+             header.load, header.peak, header.governorLevel,
+             (header.flags & kFlightClipped) ? ", clipped" : "",
+             (header.flags & kFlightOverrun) ? ", overrun" : "",
+             (header.flags & (kFlightEventsDropped | kFlightParamsDropped))
+                 ? ", inputs truncated"
+                 : "");
+    }
+
+    if (hash != header.outputHash && dump.replayLimits == 0) {
+      if (divergent == 0) {
+        printf("first divergence at block %llu: hash %08x, recorded %08x\n",
+               (unsigned long long) header.index, hash, header.outputHash);
+      }
+      divergent++;
+    }
+
+    if (raw) {
+      interleaved.resize(header.numSamples * 2);
+      for (int32 s = 0; s < header.numSamples; s++) {
+        interleaved[s * 2] = left[s];
+        interleaved[s * 2 + 1] = right[s];
+      }
+      fwrite(interleaved.data(), sizeof(Sample32), interleaved.size(), raw);
+    }
+  }
+
+  if (raw) {
+    fclose(raw);
+  }
+
+  size_t replayed = records.size() - first;
+  if (dump.replayLimits != 0) {
+    printf("%zu blocks replayed, not comparable with the recording\n",
+           replayed);
+    return 3;
+  }
+  if (divergent == 0) {
+    printf("%zu blocks replayed bit exactly\n", replayed);
+    return 0;
+  }
+  printf("%zu of %zu blocks diverged\n", divergent, replayed);
+  return 2;
+}
@@ -0,0 +1,430 @@
+/**
+ * @file session_replay.cpp
+ *
+ * @brief Replay benchmark of a Laser session capture.
+ *
+ * This tool loads a capture written by the SessionRecorder of a
+ * LaserProcessor and feeds it, block by block and at full speed, into a
+ * fresh processor: the recorded block sizes, every point of every parameter
+ * queue, every event and the ProcessContext. It reports what processing
+ * the real session costs and a hash of everything it rendered.
+ *
+ * @details
+ * The processor is set up with the recorded sample rate, maximum block size
+ * and process mode, gets the same voice group buses and starts from the
+ * parameter values recorded when the capture began; the capture and dump
+ * switches themselves are left off. The capture is parsed into memory
+ * before the first block, so only process() is timed.
+ *
+ * By default the quality governor is held at full quality, so the output
+ * and its hash only depend on the build: replaying the same capture with two
+ * builds is a regression test, --expect makes the exit status tell. With
+ * --adaptive the governor measures the load as it does live, and the output
+ * follows the timing of the run.
+ *
+ * A capture switched on in the middle of a session starts from silence:
+ * notes already sounding, ramps and effect tails are not part of it.
+ *
+ * Usage:
+ *   laser_session_replay <capture.lss> [--repeat N] [--adaptive]
+ *                        [--expect HASH] [--raw output.f32]
+ *
+ * Exit status: 0 on success, 2 if the hash differs from --expect, 1 on
+ * errors.
+ *
+ * Dependencies:
+ * - Steinberg VST3 SDK (hosting helpers)
+ *
+ * @copyright Radar2000
+ * This work is licensed under Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *
+ * @author Radar2000
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "bench_common.h"
+#include "flight_recorder.h"
+#include "session_recorder.h"
+
+using namespace Radar;
+using namespace Radar::Bench;
+
+namespace {
+
+struct Options {
+  const char* capturePath = nullptr;
+  const char* rawPath = nullptr;
+  int repeat = 1;
+  bool adaptive = false;
+  bool hasExpected = false;
+  uint32 expected = 0;
+};
+
+/// One parameter point, flattened out of its queue.
+struct ParamPoint {
+  ParamID id;
+  int32 sampleOffset;
+  ParamValue value;
+};
+
+/// Inputs of one recorded block.
+struct Block {
+  SessionBlock header;
+  ProcessContext context = {};
+  std::vector<ParamPoint> points;
+  std::vector<Event> events;
+};
+
+/// A whole capture, parsed.
+struct Capture {
+  SessionStart start;
+  std::vector<ParamPoint> initialValues;
+  std::vector<Block> blocks;
+  uint64 droppedBlocks = 0;
+};
+
+struct RunResult {
+  double seconds = 0.;         ///< Total time spent in process().
+  double worstBlock = 0.;      ///< Longest process() call in seconds.
+  double worstDeadline = 0.;   ///< Largest time / deadline of a block.
+  uint32 hash = 2166136261u;   ///< Hash of the output of every block.
+};
+
+/// Sequential reader over the payload of a record.
+struct Reader {
+  const uint8* data;
+  size_t size;
+  size_t position = 0;
+
+  bool read(void* bytes, size_t count) {
+    if (count > size - position) {
+      return false;
+    }
+    memcpy(bytes, data + position, count);
+    position += count;
+    return true;
+  }
+
+  template <typename T>
+  bool read(T& value) {
+    return read(&value, sizeof(T));
+  }
+};
+
+bool parseStart(Reader& reader, Capture& capture) {
+  if (!reader.read(capture.start) || capture.start.numParams < 0) {
+    return false;
+  }
+  for (int32 i = 0; i < capture.start.numParams; i++) {
+    ParamID id;
+    float value;
+    if (!reader.read(id) || !reader.read(value)) {
+      return false;
+    }
+    capture.initialValues.push_back({id, 0, value});
+  }
+  return true;
+}
+
+bool parseBlock(Reader& reader, Capture& capture) {
+  Block block;
+  SessionBlock& header = block.header;
+  if (!reader.read(header) || header.numQueues < 0 || header.numEvents < 0) {
+    return false;
+  }
+  if ((header.flags & kSessionHasContext) && !reader.read(block.context)) {
+    return false;
+  }
+
+  for (int32 q = 0; q < header.numQueues; q++) {
+    ParamID id;
+    int32 numPoints;
+    if (!reader.read(id) || !reader.read(numPoints) || numPoints < 0) {
+      return false;
+    }
+    for (int32 p = 0; p < numPoints; p++) {
+      ParamPoint point = {id, 0, 0.};
+      if (!reader.read(point.sampleOffset) || !reader.read(point.value)) {
+        return false;
+      }
+      block.points.push_back(point);
+    }
+  }
+
+  block.events.resize(header.numEvents);
+  for (Event& event : block.events) {
+    if (!reader.read(event)) {
+      return false;
+    }
+  }
+
+  capture.droppedBlocks += header.droppedBefore;
+  capture.blocks.push_back(std::move(block));
+  return true;
+}
+
+/**
+ * @brief Parses the first capture in `file`.
+ *
+ * @return false, with a message printed, if the file is not a capture of
+ * this build's layout.
+ */
+bool parseCapture(const std::vector<uint8>& file, Capture& capture) {
+  SessionFileHeader header;
+  if (file.size() < sizeof(header)) {
+    fprintf(stderr, "error: file too short for a capture header\n");
+    return false;
+  }
+  memcpy(&header, file.data(), sizeof(header));
+
+  const SessionFileHeader expected;
+  if (header.magic != expected.magic || header.version != expected.version) {
+    fprintf(stderr, "error: not a Laser session capture\n");
+    return false;
+  }
+  if (header.eventSize != expected.eventSize ||
+      header.contextSize != expected.contextSize) {
+    fprintf(stderr, "error: capture written by a build with another "
+                    "layout\n");
+    return false;
+  }
+
+  bool started = false;
+  size_t position = sizeof(header);
+  while (position + sizeof(SessionRecordHeader) <= file.size()) {
+    SessionRecordHeader record;
+    memcpy(&record, file.data() + position, sizeof(record));
+    position += sizeof(record);
+    if (record.size > file.size() - position) {
+      // The writer was stopped mid-record, keep what is complete
+      fprintf(stderr, "warning: capture truncated after %zu blocks\n",
+              capture.blocks.size());
+      break;
+    }
+
+    Reader reader = {file.data() + position, record.size};
+    bool valid = true;
+    switch (record.type) {
+      case kSessionStart:
+        valid = !started && parseStart(reader, capture);
+        started = true;
+        break;
+
+      case kSessionBlock:
+        valid = started && parseBlock(reader, capture);
+        break;
+
+      case kSessionEnd:
+        return started;
+    }
+    if (!valid || reader.position != reader.size) {
+      fprintf(stderr, "error: capture corrupt at block %zu\n",
+              capture.blocks.size());
+      return false;
+    }
+    position += record.size;
+  }
+  return started;
+}
+
+/**
+ * @brief Replays `capture` into a fresh processor, writing the main output
+ * to `raw` when it is not nullptr.
+ */
+RunResult run(const Capture& capture, const Options& options, FILE* raw) {
+  const SessionStart& start = capture.start;
+  ProcessorHarness harness(start.sampleRate, start.maxSamplesPerBlock);
+  if (start.groupBuses != 0) {
+    harness.setGroupBuses(start.groupBuses);
+  }
+  harness.data.processMode = start.processMode;
+  if (!options.adaptive) {
+    harness.processor->forceQualityLevel(0);
+  }
+
+  // The values the capture started from go with the first block, before its
+  // own changes. The switches would only start recording the replay
+  for (const ParamPoint& value : capture.initialValues) {
+    if (value.id != kSessionCapture && value.id != kFlightDump) {
+      harness.setParameter(value.id, value.value, 0);
+    }
+  }
+
+  RunResult result;
+  std::vector<Sample32> interleaved;
+  for (const Block& block : capture.blocks) {
+    const int32 numSamples = block.header.numSamples;
+    harness.data.numSamples = numSamples;
+    harness.context = block.context;
+    harness.data.processContext =
+        (block.header.flags & kSessionHasContext) ? &harness.context
+                                                   : nullptr;
+    for (const ParamPoint& point : block.points) {
+      harness.setParameter(point.id, point.value, point.sampleOffset);
+    }
+    for (const Event& recorded : block.events) {
+      Event event = recorded;
+      harness.events.addEvent(event);
+    }
+
+    auto begin = Clock::now();
+    harness.processor->process(harness.data);
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - begin).count();
+    harness.events.clear();
+    harness.paramChanges.clearQueue();
+
+    result.seconds += seconds;
+    result.worstBlock = std::max(result.worstBlock, seconds);
+    if (numSamples > 0) {
+      result.worstDeadline = std::max(
+          result.worstDeadline, seconds * start.sampleRate / numSamples);
+    }
+
+    const Sample32* left = harness.buffers[0].data();
+    const Sample32* right = harness.buffers[1].data();
+    result.hash = (result.hash ^
+                   FlightRecorder::hashOutput(left, right, numSamples)) *
+                  16777619u;
+
+    if (raw) {
+      interleaved.resize(numSamples * 2);
+      for (int32 s = 0; s < numSamples; s++) {
+        interleaved[s * 2] = left[s];
+        interleaved[s * 2 + 1] = right[s];
+      }
+      fwrite(interleaved.data(), sizeof(Sample32), interleaved.size(), raw);
+    }
+  }
+  return result;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--adaptive") == 0) {
+      options.adaptive = true;
+    } else if (strcmp(arg, "--repeat") == 0 && value) {
+      options.repeat = atoi(value);
+      ++i;
+    } else if (strcmp(arg, "--expect") == 0 && value) {
+      options.expected = (uint32) strtoul(value, nullptr, 16);
+      options.hasExpected = true;
+      ++i;
+    } else if (strcmp(arg, "--raw") == 0 && value) {
+      options.rawPath = value;
+      ++i;
+    } else if (arg[0] != '-' && !options.capturePath) {
+      options.capturePath = arg;
+    } else {
+      return false;
+    }
+  }
+  return options.capturePath != nullptr && options.repeat > 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr,
+            "usage: %s <capture.lss> [--repeat N] [--adaptive] "
+            "[--expect HASH] [--raw output.f32]\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::ifstream stream(options.capturePath, std::ios::binary);
+  if (!stream) {
+    fprintf(stderr, "error: cannot open %s\n", options.capturePath);
+    return 1;
+  }
+  std::vector<uint8> file((std::istreambuf_iterator<char>(stream)),
+                          std::istreambuf_iterator<char>());
+
+  Capture capture;
+  if (!parseCapture(file, capture)) {
+    return 1;
+  }
+  const SessionStart& start = capture.start;
+  if (capture.blocks.empty() || start.sampleRate <= 0. ||
+      start.maxSamplesPerBlock <= 0) {
+    fprintf(stderr, "error: capture holds no replayable blocks\n");
+    return 1;
+  }
+
+  uint64 numSamples = 0;
+  size_t numEvents = 0;
+  size_t numPoints = 0;
+  for (const Block& block : capture.blocks) {
+    if (block.header.numSamples < 0 ||
+        block.header.numSamples > start.maxSamplesPerBlock) {
+      fprintf(stderr, "error: a block has %d samples\n",
+              block.header.numSamples);
+      return 1;
+    }
+    if (block.header.numEvents > kMaxEventsPerBlock) {
+      fprintf(stderr, "warning: a block of %d events is replayed with the "
+                      "first %d\n",
+              block.header.numEvents, kMaxEventsPerBlock);
+    }
+    numSamples += block.header.numSamples;
+    numEvents += block.events.size();
+    numPoints += block.points.size();
+  }
+
+  const double duration = numSamples / start.sampleRate;
+  printf("%s: %zu blocks, %.1f s at %.0f Hz, %zu events, %zu parameter "
+         "points\n",
+         options.capturePath, capture.blocks.size(), duration,
+         start.sampleRate, numEvents, numPoints);
+  if (start.symbolicSampleSize != kSample32) {
+    printf("captured with 64-bit samples, replayed with 32-bit ones\n");
+  }
+  if (capture.droppedBlocks > 0) {
+    printf("the capture lost %llu blocks, replay runs across the gaps\n",
+           (unsigned long long) capture.droppedBlocks);
+  }
+
+  FILE* raw = nullptr;
+  if (options.rawPath && !(raw = fopen(options.rawPath, "wb"))) {
+    fprintf(stderr, "error: cannot write %s\n", options.rawPath);
+    return 1;
+  }
+
+  // The fastest run is the one least disturbed by the rest of the system
+  RunResult best;
+  for (int r = 0; r < options.repeat; r++) {
+    RunResult result = run(capture, options, r == 0 ? raw : nullptr);
+    if (r == 0 || result.seconds < best.seconds) {
+      best = result;
+    }
+  }
+  if (raw) {
+    fclose(raw);
+  }
+
+  const double blocks = (double) capture.blocks.size();
+  printf("\n%14s %14s %14s %12s\n", "us/block", "worst [us]",
+         "worst/deadline", "x realtime");
+  printf("%14.2f %14.2f %14.3f %12.1f\n", best.seconds / blocks * 1e6,
+         best.worstBlock * 1e6, best.worstDeadline, duration / best.seconds);
+  printf("\noutput hash %08x%s\n", best.hash,
+         options.adaptive ? " (adaptive quality, timing dependent)" : "");
+
+  if (options.hasExpected && best.hash != options.expected) {
+    printf("output differs from the expected hash %08x\n", options.expected);
+    return 2;
+  }
+  return 0;
+}